@@ -0,0 +1,154 @@
+// Copyright (c) 2025 Charles Hood <chood@chood.net>
+//
+// This program is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+
+#include <stdlib.h>
+#include <string.h>
+#include <SDL3/SDL.h>
+#include "backend.h"
+#include "gpu.h"
+#include "pool.h"
+#include "trace.h"
+
+// Renders whole canvases offline, either on every core or on the GPU.
+struct Backend {
+	char const *name;
+	Pool *pool;
+	Gpu *gpu;
+	struct Job *jobs;
+	bool ok;
+};
+
+typedef struct Job {
+	Canvas *canvas;
+	Rect rect;
+	RenderMode mode;
+} Job;
+
+static void run_job(void *);
+
+// Returns NULL if the name is unknown or the backend is unavailable. The CPU
+// backend uses every core, or n threads if it is named "cpu:n". A GPU backend
+// may only be used from the thread that created it.
+Backend *
+backend_create(char const *name)
+{
+	Backend *b = calloc(1, sizeof(Backend));
+	if (b == NULL) {
+		return NULL;
+	}
+	if (strncmp(name, "cpu", 3) == 0 && (name[3] == '\0' ||
+	    (name[3] == ':' && atoi(name + 4) > 0))) {
+		b->name = "cpu";
+		b->pool = pool_create(name[3] == ':' ? atoi(name + 4) : 0);
+		if (b->pool != NULL) {
+			return b;
+		}
+	} else if (strcmp(name, "gpu") == 0) {
+		b->name = "gpu";
+		b->gpu = gpu_create();
+		if (b->gpu != NULL) {
+			return b;
+		}
+	}
+	free(b);
+	return NULL;
+}
+
+void
+backend_destroy(Backend *b)
+{
+	if (b->pool != NULL) {
+		pool_destroy(b->pool);
+	}
+	if (b->gpu != NULL) {
+		gpu_destroy(b->gpu);
+	}
+	free(b);
+}
+
+char const *
+backend_name(Backend const *b)
+{
+	return b->name;
+}
+
+// Returns the number of threads that render, which is one for the GPU.
+int
+backend_threads(Backend const *b)
+{
+	return b->pool != NULL ? pool_size(b->pool) : 1;
+}
+
+// Starts rendering a canvas, which must be left alone until backend_wait
+// returns. Only one canvas can be in progress at a time. The GPU renders
+// before this returns and always renders by brute force, whatever the mode.
+bool
+backend_start(Backend *b, Canvas *c, RenderMode mode)
+{
+	if (b->gpu != NULL) {
+		b->ok = gpu_render(b->gpu, c);
+		return true;
+	}
+
+	int columns = (c->width + BACKEND_TILE_SIZE - 1) / BACKEND_TILE_SIZE;
+	int rows = (c->height + BACKEND_TILE_SIZE - 1) / BACKEND_TILE_SIZE;
+	b->jobs = malloc((size_t)columns * rows * sizeof(Job));
+	if (b->jobs == NULL) {
+		return false;
+	}
+	for (int y = 0; y < rows; ++y) {
+		for (int x = 0; x < columns; ++x) {
+			Job *j = &b->jobs[y * columns + x];
+			j->canvas = c;
+			j->rect.x = x * BACKEND_TILE_SIZE;
+			j->rect.y = y * BACKEND_TILE_SIZE;
+			j->rect.width = SDL_min(BACKEND_TILE_SIZE,
+			    c->width - j->rect.x);
+			j->rect.height = SDL_min(BACKEND_TILE_SIZE,
+			    c->height - j->rect.y);
+			j->mode = mode;
+			pool_submit(b->pool, run_job, j);
+		}
+	}
+	b->ok = true;
+	return true;
+}
+
+// Returns false if the render failed.
+bool
+backend_wait(Backend *b)
+{
+	if (b->pool != NULL) {
+		pool_wait(b->pool);
+	}
+	free(b->jobs);
+	b->jobs = NULL;
+	return b->ok;
+}
+
+bool
+backend_render(Backend *b, Canvas *c, RenderMode mode)
+{
+	return backend_start(b, c, mode) && backend_wait(b);
+}
+
+static void
+run_job(void *data)
+{
+	Job *j = data;
+	Uint64 span = trace_begin();
+	render(j->canvas, &j->rect, j->mode, NULL);
+	trace_end("tile", span);
+}
@@ -0,0 +1,34 @@
+// Copyright (c) 2025 Charles Hood <chood@chood.net>
+//
+// This program is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef BACKEND_H
+#define BACKEND_H
+
+#include "render.h"
+
+// The CPU backend splits canvases into squares of this size.
+#define BACKEND_TILE_SIZE 64
+
+typedef struct Backend Backend;
+
+Backend *backend_create(char const *);
+void backend_destroy(Backend *);
+char const *backend_name(Backend const *);
+int backend_threads(Backend const *);
+bool backend_start(Backend *, Canvas *, RenderMode);
+bool backend_wait(Backend *);
+bool backend_render(Backend *, Canvas *, RenderMode);
+
+#endif
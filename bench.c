@@ -0,0 +1,223 @@
+// Copyright (c) 2025 Charles Hood <chood@chood.net>
+//
+// This program is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <SDL3/SDL.h>
+#include "backend.h"
+#include "bench.h"
+#include "check.h"
+#include "headless.h"
+
+#define BENCH_MAX_BACKENDS 8
+
+typedef enum {
+	FORMAT_CSV,
+	FORMAT_JSON,
+} Format;
+
+typedef struct {
+	char const *view;
+	char const *backend;
+	RenderMode mode;
+	int threads;
+	int width;
+	int height;
+	int iterations;
+	int runs;
+	double seconds;
+	uint64_t total;
+} Result;
+
+static bool bench_view(Backend *, ReferenceView const *, RenderMode, int,
+    int, int, Result *);
+static int cmp_double(void const *, void const *);
+static void print_result(Result const *, Format, bool);
+static void usage(void);
+
+// Renders the reference views at a fixed size with every backend, and with
+// every mode on the CPU, and reports the median of several runs after one
+// that warms up caches and the GPU. Results go to standard output as CSV or
+// JSON, one record per view, backend and mode, so that they can be compared
+// across versions.
+int
+bench_main(int argc, char **argv)
+{
+	char const *backends[BENCH_MAX_BACKENDS] = {"cpu", "gpu"};
+	int backend_count = 0;
+	Format format = FORMAT_CSV;
+	int width = 1024, height = 640, runs = 5;
+	int c;
+	while ((c = getopt(argc, argv, "b:f:g:n:")) != -1) {
+		if (c == 'b' && backend_count < BENCH_MAX_BACKENDS) {
+			backends[backend_count++] = optarg;
+		} else if (c == 'f' && strcmp(optarg, "csv") == 0) {
+			format = FORMAT_CSV;
+		} else if (c == 'f' && strcmp(optarg, "json") == 0) {
+			format = FORMAT_JSON;
+		} else if (c == 'g') {
+			if (!parse_size(optarg, &width, &height)) {
+				usage();
+			}
+		} else if (c == 'n' && atoi(optarg) > 0) {
+			runs = atoi(optarg);
+		} else {
+			usage();
+		}
+	}
+	if (backend_count == 0) {
+		backend_count = 2;
+	}
+
+	RenderMode cpu_modes[] = {RENDER_MODE_BRUTE, RENDER_MODE_TRACE,
+	    RENDER_MODE_GUESS};
+	RenderMode gpu_modes[] = {RENDER_MODE_BRUTE};
+	bool ok = true, first = true;
+	if (format == FORMAT_JSON) {
+		printf("[\n");
+	}
+	for (int i = 0; i < backend_count; ++i) {
+		// Backends that are unavailable here are left out, so that the
+		// same command works on machines without a GPU.
+		Backend *b = backend_create(backends[i]);
+		if (b == NULL) {
+			fprintf(stderr, "%s: backend is unknown or unavailable, "
+			    "skipped\n", backends[i]);
+			continue;
+		}
+		bool gpu = strcmp(backend_name(b), "gpu") == 0;
+		RenderMode const *modes = gpu ? gpu_modes : cpu_modes;
+		int mode_count = gpu ? 1 : 3;
+		for (int j = 0; j < reference_view_count; ++j) {
+			bool selected = optind == argc;
+			for (int k = optind; k < argc; ++k) {
+				selected |= strcmp(argv[k],
+				    reference_views[j].name) == 0;
+			}
+			for (int k = 0; k < mode_count && selected; ++k) {
+				Result r;
+				if (!bench_view(b, &reference_views[j],
+				    modes[k], width, height, runs, &r)) {
+					ok = false;
+					continue;
+				}
+				r.backend = backends[i];
+				print_result(&r, format, first);
+				first = false;
+				fflush(stdout);
+			}
+		}
+		backend_destroy(b);
+	}
+	if (format == FORMAT_JSON) {
+		printf("%s]\n", first ? "" : "\n");
+	}
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static bool
+bench_view(Backend *b, ReferenceView const *ref, RenderMode mode, int width,
+    int height, int runs, Result *r)
+{
+	View view;
+	Canvas canvas;
+	double *seconds = malloc(runs * sizeof(double));
+	fit_view(&ref->view, width, height, &view);
+	if (seconds == NULL || !canvas_init(&canvas, &view, ref->iterations,
+	    width, height)) {
+		exit(EXIT_FAILURE);
+	}
+
+	bool ok = backend_render(b, &canvas, mode);
+	for (int i = 0; i < runs && ok; ++i) {
+		Uint64 start = SDL_GetTicksNS();
+		ok = backend_render(b, &canvas, mode);
+		seconds[i] = (SDL_GetTicksNS() - start) / 1e9;
+	}
+	if (!ok) {
+		fprintf(stderr, "%s: %s render of %s failed\n",
+		    backend_name(b), render_mode_name(mode), ref->name);
+		free(seconds);
+		canvas_free(&canvas);
+		return false;
+	}
+	qsort(seconds, runs, sizeof(double), cmp_double);
+
+	r->view = ref->name;
+	r->mode = mode;
+	r->threads = backend_threads(b);
+	r->width = width;
+	r->height = height;
+	r->iterations = ref->iterations;
+	r->runs = runs;
+	r->seconds = runs % 2 == 1 ? seconds[runs / 2] :
+	    (seconds[runs / 2 - 1] + seconds[runs / 2]) / 2.;
+	r->total = 0;
+	for (size_t i = 0; i < (size_t)width * height; ++i) {
+		r->total += canvas.counts[i];
+	}
+	free(seconds);
+	canvas_free(&canvas);
+	return true;
+}
+
+static int
+cmp_double(void const *a, void const *b)
+{
+	double x = *(double const *)a, y = *(double const *)b;
+	return (x > y) - (x < y);
+}
+
+// Throughput in iterations counts the escape counts of the image, so modes
+// that skip pixels show how many iterations they effectively replace.
+static void
+print_result(Result const *r, Format format, bool first)
+{
+	double pixels = (double)r->width * r->height;
+	double mpix = pixels / r->seconds / 1e6;
+	double giter = r->total / r->seconds / 1e9;
+	if (format == FORMAT_JSON) {
+		printf("%s  {\"view\": \"%s\", \"backend\": \"%s\", "
+		    "\"mode\": \"%s\", \"threads\": %d, \"width\": %d, "
+		    "\"height\": %d, \"iterations\": %d, \"runs\": %d, "
+		    "\"wall_ms\": %.3f, \"mpix_per_s\": %.3f, "
+		    "\"giter_per_s\": %.3f}", first ? "" : ",\n", r->view,
+		    r->backend, render_mode_name(r->mode), r->threads,
+		    r->width, r->height, r->iterations, r->runs,
+		    r->seconds * 1e3, mpix, giter);
+		return;
+	}
+	if (first) {
+		printf("view,backend,mode,threads,width,height,iterations,runs,"
+		    "wall_ms,mpix_per_s,giter_per_s\n");
+	}
+	printf("%s,%s,%s,%d,%d,%d,%d,%d,%.3f,%.3f,%.3f\n", r->view,
+	    r->backend, render_mode_name(r->mode), r->threads, r->width,
+	    r->height, r->iterations, r->runs, r->seconds * 1e3, mpix, giter);
+}
+
+static void
+usage(void)
+{
+	fprintf(stderr, "usage: mandelbrot bench [-b backend]... [-f csv|json] "
+	    "[-g WIDTHxHEIGHT] [-n runs]\n"
+	    "                        [view...]\n");
+	exit(EXIT_FAILURE);
+}
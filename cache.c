@@ -0,0 +1,230 @@
+// Copyright (c) 2025 Charles Hood <chood@chood.net>
+//
+// This program is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+
+#include <math.h>
+#include <stdlib.h>
+#include <SDL3/SDL.h>
+#include "cache.h"
+#include "codec.h"
+
+// A guess at the size of an encoded tile, used to size the hash table.
+#define TILE_BYTES (CODEC_BOUND(TILE_SIZE * TILE_SIZE) / 8)
+
+typedef struct Entry Entry;
+struct Entry {
+	TileKey key;
+	uint8_t *data;
+	size_t length;
+	Entry *next;
+	Entry *newer;
+	Entry *older;
+};
+
+// Tiles are kept in a hash table with chaining and in a list ordered by last
+// use, from which the least recently used tiles are evicted once the budget
+// is exceeded. The cache does not look inside a tile's data, which is counts
+// encoded by codec_encode() for the renderer. The size and capacity are in
+// bytes.
+struct Cache {
+	SDL_Mutex *mutex;
+	size_t capacity;
+	size_t size;
+	size_t bucket_count;
+	Entry **buckets;
+	Entry *newest;
+	Entry *oldest;
+};
+
+static size_t hash(TileKey const *);
+static bool key_equal(TileKey const *, TileKey const *);
+static void unlink_entry(Cache *, Entry *);
+static void push_newest(Cache *, Entry *);
+static void evict(Cache *);
+
+void
+tile_view(TileKey const *k, View *v)
+{
+	double width = ldexp(TILE_EXTENT, -k->level);
+	v->x = (k->x + .5) * width;
+	v->y = (k->y + .5) * width;
+	v->width = .5 * width;
+	v->height = .5 * width;
+}
+
+// Returns the level whose tile pixels are closest in size to the pixels of a
+// view that is the given number of pixels wide.
+int
+tile_level(View const *v, int width)
+{
+	double pixel = 2. * v->width / width;
+	double level = round(log2(TILE_EXTENT / (TILE_SIZE * pixel)));
+	return level < 0. ? 0 : (int)level;
+}
+
+// The budget is in bytes of encoded tiles and their bookkeeping.
+Cache *
+cache_create(size_t budget)
+{
+	Cache *c = calloc(1, sizeof(Cache));
+	if (c == NULL) {
+		return NULL;
+	}
+	c->capacity = budget;
+	c->bucket_count = 1;
+	while (c->bucket_count < 2 * (budget / TILE_BYTES)) {
+		c->bucket_count *= 2;
+	}
+	c->buckets = calloc(c->bucket_count, sizeof(Entry *));
+	c->mutex = SDL_CreateMutex();
+	if (c->buckets == NULL || c->mutex == NULL) {
+		free(c->buckets);
+		SDL_DestroyMutex(c->mutex);
+		free(c);
+		return NULL;
+	}
+	return c;
+}
+
+void
+cache_lock(Cache *c)
+{
+	SDL_LockMutex(c->mutex);
+}
+
+void
+cache_unlock(Cache *c)
+{
+	SDL_UnlockMutex(c->mutex);
+}
+
+// Returns the data of a tile and its length, or NULL if it is not cached. The
+// cache must be locked, and the data is only valid until it is unlocked.
+uint8_t const *
+cache_find(Cache *c, TileKey const *key, size_t *length)
+{
+	Entry *e = c->buckets[hash(key) & (c->bucket_count - 1)];
+	for (; e != NULL; e = e->next) {
+		if (key_equal(&e->key, key)) {
+			unlink_entry(c, e);
+			push_newest(c, e);
+			*length = e->length;
+			return e->data;
+		}
+	}
+	return NULL;
+}
+
+// Takes ownership of a tile's data, allocated with malloc(). The cache must
+// be locked.
+void
+cache_insert(Cache *c, TileKey const *key, uint8_t *data, size_t length)
+{
+	Entry **bucket = &c->buckets[hash(key) & (c->bucket_count - 1)];
+	for (Entry *e = *bucket; e != NULL; e = e->next) {
+		if (key_equal(&e->key, key)) {
+			c->size += length - e->length;
+			free(e->data);
+			e->data = data;
+			e->length = length;
+			unlink_entry(c, e);
+			push_newest(c, e);
+			while (c->size > c->capacity && c->oldest != e) {
+				evict(c);
+			}
+			return;
+		}
+	}
+
+	Entry *e = malloc(sizeof(Entry));
+	if (e == NULL) {
+		free(data);
+		return;
+	}
+	e->key = *key;
+	e->data = data;
+	e->length = length;
+	e->next = *bucket;
+	*bucket = e;
+	push_newest(c, e);
+	c->size += sizeof(Entry) + length;
+
+	while (c->size > c->capacity && c->oldest != e) {
+		evict(c);
+	}
+}
+
+static size_t
+hash(TileKey const *k)
+{
+	uint64_t h = 0xcbf29ce484222325u;
+	uint64_t fields[] = {k->level, k->x, k->y, k->iterations, k->mode};
+	for (size_t i = 0; i < SDL_arraysize(fields); ++i) {
+		h = (h ^ fields[i]) * 0x100000001b3u;
+		h ^= h >> 29;
+	}
+	return h;
+}
+
+static bool
+key_equal(TileKey const *a, TileKey const *b)
+{
+	return a->level == b->level && a->x == b->x && a->y == b->y &&
+	    a->iterations == b->iterations && a->mode == b->mode;
+}
+
+static void
+unlink_entry(Cache *c, Entry *e)
+{
+	if (e->newer != NULL) {
+		e->newer->older = e->older;
+	} else {
+		c->newest = e->older;
+	}
+	if (e->older != NULL) {
+		e->older->newer = e->newer;
+	} else {
+		c->oldest = e->newer;
+	}
+}
+
+static void
+push_newest(Cache *c, Entry *e)
+{
+	e->newer = NULL;
+	e->older = c->newest;
+	if (c->newest != NULL) {
+		c->newest->newer = e;
+	} else {
+		c->oldest = e;
+	}
+	c->newest = e;
+}
+
+static void
+evict(Cache *c)
+{
+	Entry *e = c->oldest;
+	unlink_entry(c, e);
+
+	Entry **p = &c->buckets[hash(&e->key) & (c->bucket_count - 1)];
+	while (*p != e) {
+		p = &(*p)->next;
+	}
+	*p = e->next;
+
+	c->size -= sizeof(Entry) + e->length;
+	free(e->data);
+	free(e);
+}
@@ -0,0 +1,48 @@
+// Copyright (c) 2025 Charles Hood <chood@chood.net>
+//
+// This program is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "render.h"
+
+#define TILE_SIZE 128
+#define TILE_EXTENT 4.
+
+// Tiles form a quadtree over the complex plane. At level n a tile is
+// TILE_EXTENT / 2^n wide and tile (x, y) has its lower left corner at
+// (x, y) times that width.
+typedef struct {
+	int level;
+	int64_t x;
+	int64_t y;
+	int iterations;
+	RenderMode mode;
+} TileKey;
+
+typedef struct Cache Cache;
+
+void tile_view(TileKey const *, View *);
+int tile_level(View const *, int);
+
+Cache *cache_create(size_t);
+void cache_lock(Cache *);
+void cache_unlock(Cache *);
+uint8_t const *cache_find(Cache *, TileKey const *, size_t *);
+void cache_insert(Cache *, TileKey const *, uint8_t *, size_t);
+
+#endif
@@ -0,0 +1,134 @@
+// Copyright (c) 2025 Charles Hood <chood@chood.net>
+//
+// This program is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL3/SDL.h>
+#include "backend.h"
+#include "cache.h"
+#include "check.h"
+
+#define CHECK_WIDTH 640
+#define CHECK_HEIGHT 400
+
+typedef struct {
+	RenderMode mode;
+	bool exact;
+} CheckedMode;
+
+static bool check_view(ReferenceView const *, CheckedMode const *, int);
+static double render_timed(Canvas *, RenderMode, int);
+
+ReferenceView const reference_views[] = {
+	{"full", {-.5, 0., 1.25, 1.25}, 256},
+	{"seahorse", {-.75, .1, .05, .05}, 4096},
+	{"elephant", {.275, .007, .01, .01}, 4096},
+	{"minibrot", {-1.7687, 0., .022, .022}, 8192},
+	{"deep", {-.743643887037151, .131825904205330, 1.2e-7, 1.2e-7},
+	    4096},
+};
+
+int const reference_view_count =
+    sizeof(reference_views) / sizeof(reference_views[0]);
+
+int
+check_main(int argc, char **argv)
+{
+	// Guessing may miss details smaller than its blocks, so its errors
+	// are only reported.
+	CheckedMode modes[] = {
+		{RENDER_MODE_TRACE, true},
+		{RENDER_MODE_GUESS, false},
+	};
+	int mode_count = sizeof(modes) / sizeof(modes[0]);
+
+	// Tracing works within the rectangle it is given, so the views are also
+	// rendered in the squares of the CPU backend and of the cache.
+	int const tiles[] = {0, BACKEND_TILE_SIZE, TILE_SIZE};
+	int tile_count = sizeof(tiles) / sizeof(tiles[0]);
+
+	bool ok = true;
+	for (int i = 0; i < reference_view_count; ++i) {
+		char const *name = reference_views[i].name;
+		bool selected = argc <= 1;
+		for (int j = 1; j < argc; ++j) {
+			selected |= strcmp(argv[j], name) == 0;
+		}
+		if (!selected) {
+			continue;
+		}
+		for (int j = 0; j < mode_count; ++j) {
+			for (int k = 0; k < tile_count; ++k) {
+				ok &= check_view(&reference_views[i], &modes[j],
+				    tiles[k]);
+			}
+		}
+	}
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Renders the view in squares of the given size, or whole if it is zero.
+static bool
+check_view(ReferenceView const *ref, CheckedMode const *mode, int tile)
+{
+	View view;
+	fit_view(&ref->view, CHECK_WIDTH, CHECK_HEIGHT, &view);
+
+	Canvas expected, actual;
+	if (!canvas_init(&expected, &view, ref->iterations, CHECK_WIDTH,
+	    CHECK_HEIGHT) || !canvas_init(&actual, &view, ref->iterations,
+	    CHECK_WIDTH, CHECK_HEIGHT)) {
+		fprintf(stderr, "%s: out of memory\n", ref->name);
+		exit(EXIT_FAILURE);
+	}
+
+	double brute_time = render_timed(&expected, RENDER_MODE_BRUTE, tile);
+	double time = render_timed(&actual, mode->mode, tile);
+
+	size_t n = (size_t)CHECK_WIDTH * CHECK_HEIGHT, differing = 0;
+	double error = 0.;
+	for (size_t i = 0; i < n; ++i) {
+		uint32_t a = expected.counts[i], b = actual.counts[i];
+		differing += a != b;
+		error += a > b ? a - b : b - a;
+	}
+	char size[32];
+	snprintf(size, sizeof(size), "%dx%d", tile ? tile : CHECK_WIDTH,
+	    tile ? tile : CHECK_HEIGHT);
+	printf("%-10s %-6s %-8s %8zu of %zu pixels differ (%.3f%%), "
+	    "mean error %.3f, %8.1f ms (brute %.1f ms)\n", ref->name,
+	    render_mode_name(mode->mode), size, differing, n,
+	    100. * differing / n, error / n, time, brute_time);
+
+	canvas_free(&expected);
+	canvas_free(&actual);
+	return differing == 0 || !mode->exact;
+}
+
+static double
+render_timed(Canvas *c, RenderMode mode, int tile)
+{
+	int w = tile ? tile : c->width, h = tile ? tile : c->height;
+	Uint64 start = SDL_GetTicksNS();
+	for (int y = 0; y < c->height; y += h) {
+		for (int x = 0; x < c->width; x += w) {
+			Rect r = {x, y, SDL_min(w, c->width - x),
+			    SDL_min(h, c->height - y)};
+			render(c, &r, mode, NULL);
+		}
+	}
+	return (SDL_GetTicksNS() - start) / 1e6;
+}
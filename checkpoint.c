@@ -0,0 +1,355 @@
+// Copyright (c) 2025 Charles Hood <chood@chood.net>
+//
+// This program is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <SDL3/SDL.h>
+#include "checkpoint.h"
+#include "codec.h"
+
+#define CHECKPOINT_MAGIC "MBCHECK1"
+#define CHECKPOINT_QUEUE 4
+#define CHECKPOINT_SYNC_NS 10000000000
+
+// The file is this header followed by a record for each finished band, in
+// the order they were finished. A record is a RecordHeader and the band's
+// counts as encoded by codec_encode().
+typedef struct {
+	char magic[8];
+	uint32_t formula;
+	uint32_t iterations;
+	uint32_t width;
+	uint32_t height;
+	uint32_t band_height;
+	uint32_t mode;
+	double view[4];
+} Header;
+
+typedef struct {
+	uint32_t band;
+	uint32_t length;
+	uint32_t checksum;
+	uint32_t reserved;
+} RecordHeader;
+
+typedef struct Pending Pending;
+struct Pending {
+	int band;
+	int height;
+	uint32_t *counts;
+	Pending *next;
+};
+
+// Bands are saved by a thread of their own, so that rendering only waits for
+// a copy of the counts unless the disk falls several bands behind.
+struct Checkpoint {
+	int fd;
+	int width;
+	int height;
+	int band_height;
+	int band_count;
+	off_t *offsets;
+	off_t end;
+	int count;
+	uint8_t *buffer;
+	SDL_Mutex *mutex;
+	SDL_Condition *changed;
+	Pending *head;
+	Pending *tail;
+	int pending;
+	bool quit;
+	bool failed;
+	SDL_Thread *thread;
+};
+
+static bool read_records(Checkpoint *);
+static int band_rows(Checkpoint const *, int);
+static uint32_t checksum(uint8_t const *, size_t);
+static int run_writer(void *);
+static bool write_band(Checkpoint *, Pending const *);
+
+// Starts a checkpoint for a render in bands of rows. When resuming, the file
+// has to be a checkpoint of the same render, and its finished bands are kept;
+// otherwise it is started over. Returns NULL if the file cannot be used.
+Checkpoint *
+checkpoint_open(char const *path, RenderOptions const *o, int band_height,
+    bool resume)
+{
+	View view;
+	render_options_view(o, &view);
+	Header h;
+	memset(&h, 0, sizeof(Header));
+	memcpy(h.magic, CHECKPOINT_MAGIC, sizeof(h.magic));
+	h.formula = RENDER_FORMULA;
+	h.iterations = o->iterations;
+	h.width = o->width;
+	h.height = o->height;
+	h.band_height = band_height;
+	h.mode = o->mode;
+	h.view[0] = view.x;
+	h.view[1] = view.y;
+	h.view[2] = view.width;
+	h.view[3] = view.height;
+
+	Checkpoint *k = calloc(1, sizeof(Checkpoint));
+	if (k == NULL) {
+		return NULL;
+	}
+	k->width = o->width;
+	k->height = o->height;
+	k->band_height = band_height;
+	k->band_count = (o->height + band_height - 1) / band_height;
+	k->offsets = malloc(k->band_count * sizeof(off_t));
+	k->buffer = malloc(sizeof(RecordHeader) +
+	    CODEC_BOUND((size_t)o->width * band_height));
+	k->mutex = SDL_CreateMutex();
+	k->changed = SDL_CreateCondition();
+	k->fd = open(path, resume ? O_RDWR : O_RDWR | O_CREAT | O_TRUNC,
+	    0644);
+	if (k->offsets == NULL || k->buffer == NULL || k->mutex == NULL ||
+	    k->changed == NULL || k->fd == -1) {
+		goto fail;
+	}
+	for (int i = 0; i < k->band_count; ++i) {
+		k->offsets[i] = -1;
+	}
+
+	if (resume) {
+		Header old;
+		if (pread(k->fd, &old, sizeof(Header), 0) != sizeof(Header) ||
+		    memcmp(&old, &h, sizeof(Header)) != 0 ||
+		    !read_records(k) || ftruncate(k->fd, k->end) != 0) {
+			goto fail;
+		}
+	} else {
+		if (pwrite(k->fd, &h, sizeof(Header), 0) != sizeof(Header)) {
+			goto fail;
+		}
+		k->end = sizeof(Header);
+	}
+
+	k->thread = SDL_CreateThread(run_writer, "checkpoint", k);
+	if (k->thread == NULL) {
+		goto fail;
+	}
+	return k;
+
+fail:
+	if (k->fd != -1) {
+		close(k->fd);
+	}
+	SDL_DestroyCondition(k->changed);
+	SDL_DestroyMutex(k->mutex);
+	free(k->buffer);
+	free(k->offsets);
+	free(k);
+	return NULL;
+}
+
+// Returns the number of bands that were finished when the checkpoint was
+// opened.
+int
+checkpoint_count(Checkpoint const *k)
+{
+	return k->count;
+}
+
+// Reads a finished band into a canvas for its rows, returning false if it is
+// not in the checkpoint.
+bool
+checkpoint_load(Checkpoint *k, int band, Canvas *c)
+{
+	if (k->offsets[band] == -1 || c->height != band_rows(k, band)) {
+		return false;
+	}
+	RecordHeader r;
+	if (pread(k->fd, &r, sizeof(RecordHeader), k->offsets[band]) !=
+	    sizeof(RecordHeader)) {
+		return false;
+	}
+	uint8_t *data = malloc(r.length);
+	bool ok = data != NULL && pread(k->fd, data, r.length,
+	    k->offsets[band] + sizeof(RecordHeader)) == (ssize_t)r.length &&
+	    codec_decode(data, r.length, c->width, c->height, c->counts);
+	free(data);
+	return ok;
+}
+
+// Queues a finished band to be saved.
+void
+checkpoint_save(Checkpoint *k, int band, Canvas const *c)
+{
+	Pending *p = malloc(sizeof(Pending));
+	size_t size = (size_t)c->width * c->height * sizeof(uint32_t);
+	uint32_t *counts = malloc(size);
+	if (p == NULL || counts == NULL) {
+		free(p);
+		free(counts);
+		return;
+	}
+	memcpy(counts, c->counts, size);
+	p->band = band;
+	p->height = c->height;
+	p->counts = counts;
+	p->next = NULL;
+
+	SDL_LockMutex(k->mutex);
+	while (k->pending >= CHECKPOINT_QUEUE) {
+		SDL_WaitCondition(k->changed, k->mutex);
+	}
+	if (k->tail == NULL) {
+		k->head = p;
+	} else {
+		k->tail->next = p;
+	}
+	k->tail = p;
+	++k->pending;
+	SDL_BroadcastCondition(k->changed);
+	SDL_UnlockMutex(k->mutex);
+}
+
+// Saves the queued bands and closes the file. Returns false if any band
+// could not be saved.
+bool
+checkpoint_close(Checkpoint *k)
+{
+	SDL_LockMutex(k->mutex);
+	k->quit = true;
+	SDL_BroadcastCondition(k->changed);
+	SDL_UnlockMutex(k->mutex);
+	SDL_WaitThread(k->thread, NULL);
+
+	bool ok = !k->failed && fdatasync(k->fd) == 0;
+	ok &= close(k->fd) == 0;
+	SDL_DestroyCondition(k->changed);
+	SDL_DestroyMutex(k->mutex);
+	free(k->buffer);
+	free(k->offsets);
+	free(k);
+	return ok;
+}
+
+// Finds the records of a checkpoint that is being resumed. A record that was
+// cut off by the process being killed ends the file.
+static bool
+read_records(Checkpoint *k)
+{
+	struct stat st;
+	if (fstat(k->fd, &st) != 0) {
+		return false;
+	}
+	off_t offset = sizeof(Header);
+	RecordHeader r;
+	while (pread(k->fd, &r, sizeof(RecordHeader), offset) ==
+	    sizeof(RecordHeader)) {
+		off_t data = offset + sizeof(RecordHeader);
+		if (r.band >= (uint32_t)k->band_count || r.length >
+		    CODEC_BOUND((size_t)k->width * k->band_height) ||
+		    data + r.length > st.st_size ||
+		    pread(k->fd, k->buffer, r.length, data) !=
+		    (ssize_t)r.length ||
+		    checksum(k->buffer, r.length) != r.checksum) {
+			break;
+		}
+		if (k->offsets[r.band] == -1) {
+			++k->count;
+		}
+		k->offsets[r.band] = offset;
+		offset = data + r.length;
+	}
+	k->end = offset;
+	return true;
+}
+
+static int
+band_rows(Checkpoint const *k, int band)
+{
+	return SDL_min(k->band_height, k->height - band * k->band_height);
+}
+
+// FNV-1a, enough to tell a record that was only partly written.
+static uint32_t
+checksum(uint8_t const *data, size_t length)
+{
+	uint32_t h = 0x811c9dc5u;
+	for (size_t i = 0; i < length; ++i) {
+		h = (h ^ data[i]) * 0x01000193u;
+	}
+	return h;
+}
+
+static int
+run_writer(void *data)
+{
+	Checkpoint *k = data;
+	Uint64 synced = SDL_GetTicksNS();
+
+	SDL_LockMutex(k->mutex);
+	for (;;) {
+		while (k->head == NULL && !k->quit) {
+			SDL_WaitCondition(k->changed, k->mutex);
+		}
+		if (k->head == NULL) {
+			break;
+		}
+		Pending *p = k->head;
+		k->head = p->next;
+		if (k->head == NULL) {
+			k->tail = NULL;
+		}
+		SDL_UnlockMutex(k->mutex);
+
+		bool ok = p->height == band_rows(k, p->band) &&
+		    write_band(k, p);
+		if (ok && SDL_GetTicksNS() - synced >= CHECKPOINT_SYNC_NS) {
+			ok = fdatasync(k->fd) == 0;
+			synced = SDL_GetTicksNS();
+		}
+		free(p->counts);
+		free(p);
+
+		SDL_LockMutex(k->mutex);
+		k->failed |= !ok;
+		--k->pending;
+		SDL_BroadcastCondition(k->changed);
+	}
+	SDL_UnlockMutex(k->mutex);
+	return 0;
+}
+
+static bool
+write_band(Checkpoint *k, Pending const *p)
+{
+	RecordHeader r;
+	uint8_t *data = k->buffer + sizeof(RecordHeader);
+	r.band = p->band;
+	r.length = codec_encode(p->counts, k->width, p->height, data);
+	r.checksum = checksum(data, r.length);
+	r.reserved = 0;
+	memcpy(k->buffer, &r, sizeof(RecordHeader));
+
+	size_t size = sizeof(RecordHeader) + r.length;
+	if (pwrite(k->fd, k->buffer, size, k->end) != (ssize_t)size) {
+		return false;
+	}
+	k->end += size;
+	return true;
+}
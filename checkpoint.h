@@ -0,0 +1,31 @@
+// Copyright (c) 2025 Charles Hood <chood@chood.net>
+//
+// This program is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <stdbool.h>
+#include "headless.h"
+#include "render.h"
+
+typedef struct Checkpoint Checkpoint;
+
+Checkpoint *checkpoint_open(char const *, RenderOptions const *, int, bool);
+int checkpoint_count(Checkpoint const *);
+bool checkpoint_load(Checkpoint *, int, Canvas *);
+void checkpoint_save(Checkpoint *, int, Canvas const *);
+bool checkpoint_close(Checkpoint *);
+
+#endif
@@ -0,0 +1,778 @@
+// Copyright (c) 2025 Charles Hood <chood@chood.net>
+//
+// This program is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <SDL3/SDL.h>
+#include "backend.h"
+#include "cluster.h"
+#include "codec.h"
+#include "headless.h"
+#include "image.h"
+#include "net.h"
+
+#define CLUSTER_MAGIC "MBWORKR1"
+#define CLUSTER_TILE_SIZE 256
+#define CLUSTER_DEPTH 2
+#define CLUSTER_WINDOW 4
+#define CLUSTER_QUIT UINT32_MAX
+#define CLUSTER_CONNECT_TRIES 100
+#define CLUSTER_TIMEOUT 60
+
+// Workers connect to the coordinator and introduce themselves with a Hello.
+// The coordinator then sends JobMessages, up to CLUSTER_DEPTH at a time, and
+// each worker answers every job in order with a ResultMessage followed by
+// the counts as encoded by codec_encode(). A job with the id CLUSTER_QUIT
+// tells the worker to exit. Messages are in host byte order.
+typedef struct {
+	char magic[8];
+	uint32_t formula;
+	uint32_t pid;
+} Hello;
+
+typedef struct {
+	uint32_t id;
+	uint32_t iterations;
+	uint32_t width;
+	uint32_t height;
+	uint32_t mode;
+	uint32_t reserved;
+	double view[4];
+} JobMessage;
+
+typedef struct {
+	uint32_t id;
+	uint32_t length;
+	uint64_t nanoseconds;
+} ResultMessage;
+
+typedef enum {
+	JOB_QUEUED,
+	JOB_SENT,
+	JOB_DONE,
+} JobState;
+
+// A job that is sent has a deadline, after which its worker is taken to have
+// hung even if its connection is still open.
+typedef struct {
+	Rect rect;
+	JobState state;
+	int worker;
+	Uint64 deadline;
+	uint32_t *counts;
+} Job;
+
+typedef enum {
+	READ_HELLO,
+	READ_RESULT,
+	READ_DATA,
+} ReadState;
+
+// A connected worker. The file descriptor is -1 once it has gone away.
+typedef struct {
+	int fd;
+	uint32_t pid;
+	ReadState state;
+	union {
+		Hello hello;
+		ResultMessage result;
+	} message;
+	uint8_t *data;
+	size_t got;
+	int in_flight;
+	int jobs;
+	uint64_t pixels;
+	uint64_t nanoseconds;
+	bool failed;
+	bool timed_out;
+} Worker;
+
+typedef struct {
+	RenderOptions options;
+	View view;
+	int columns;
+	int rows;
+	Job *jobs;
+	Uint64 timeout;
+	int cursor;
+	int written;
+	Worker *workers;
+	int worker_count;
+	int listen_fd;
+	ImageWriter *writer;
+	Canvas band;
+	uint8_t *pixels;
+} Coordinator;
+
+static bool spawn_workers(char const *, char const *, int, pid_t *, int);
+static bool children_alive(pid_t *, int);
+static void add_worker(Coordinator *);
+static void dispatch(Coordinator *, int);
+static int next_job(Coordinator *);
+static bool receive(Coordinator *, int);
+static bool finish_message(Coordinator *, int);
+static void expire_jobs(Coordinator *);
+static void drop_worker(Coordinator *, int);
+static bool write_rows(Coordinator *);
+static void report(Coordinator const *, double);
+static void job_view(Coordinator const *, Rect const *, View *);
+static int run_worker(char const *, char const *);
+static void coordinator_usage(void);
+static void worker_usage(void);
+
+// Splits an image into tiles and has them rendered by worker processes, which
+// connect over a Unix or TCP socket. Tiles are handed out in rows from the
+// top so that finished rows can be written and freed, and the tiles of a
+// worker that goes away are handed to the others.
+int
+coordinator_main(int argc, char **argv)
+{
+	Coordinator c;
+	memset(&c, 0, sizeof(Coordinator));
+	render_options_init(&c.options);
+	char const *address = NULL;
+	int local_count = 0;
+	c.timeout = CLUSTER_TIMEOUT * SDL_NS_PER_SECOND;
+	int option;
+	while ((option = getopt(argc, argv, RENDER_OPTIONS "l:t:w:")) != -1) {
+		if (option == 'l') {
+			address = optarg;
+		} else if (option == 't') {
+			int seconds = atoi(optarg);
+			if (seconds <= 0) {
+				coordinator_usage();
+			}
+			c.timeout = seconds * SDL_NS_PER_SECOND;
+		} else if (option == 'w') {
+			local_count = atoi(optarg);
+			if (local_count <= 0) {
+				coordinator_usage();
+			}
+		} else if (!render_options_parse(&c.options, option,
+		    optarg)) {
+			coordinator_usage();
+		}
+	}
+	if (c.options.path == NULL || optind != argc ||
+	    (address == NULL && local_count == 0)) {
+		coordinator_usage();
+	}
+
+	// Without an address, local workers meet the coordinator at a
+	// temporary Unix socket.
+	char temporary[64];
+	if (address == NULL) {
+		snprintf(temporary, sizeof(temporary),
+		    "/tmp/mandelbrot-%ld.sock", (long)getpid());
+		address = temporary;
+	}
+	c.listen_fd = net_listen(address);
+	if (c.listen_fd == -1) {
+		fprintf(stderr, "%s: cannot listen\n", address);
+		return EXIT_FAILURE;
+	}
+	c.writer = image_create(c.options.path, c.options.width,
+	    c.options.height);
+	if (c.writer == NULL) {
+		fprintf(stderr, "%s: cannot create image\n", c.options.path);
+		return EXIT_FAILURE;
+	}
+
+	render_options_view(&c.options, &c.view);
+	c.columns = (c.options.width + CLUSTER_TILE_SIZE - 1) /
+	    CLUSTER_TILE_SIZE;
+	c.rows = (c.options.height + CLUSTER_TILE_SIZE - 1) /
+	    CLUSTER_TILE_SIZE;
+	c.jobs = calloc((size_t)c.columns * c.rows, sizeof(Job));
+	c.pixels = malloc((size_t)c.options.width * CLUSTER_TILE_SIZE * 4);
+	if (c.jobs == NULL || c.pixels == NULL || !canvas_init(&c.band,
+	    &c.view, c.options.iterations, c.options.width,
+	    CLUSTER_TILE_SIZE)) {
+		exit(EXIT_FAILURE);
+	}
+	for (int y = 0; y < c.rows; ++y) {
+		for (int x = 0; x < c.columns; ++x) {
+			Rect *r = &c.jobs[y * c.columns + x].rect;
+			r->x = x * CLUSTER_TILE_SIZE;
+			r->y = y * CLUSTER_TILE_SIZE;
+			r->width = SDL_min(CLUSTER_TILE_SIZE,
+			    c.options.width - r->x);
+			r->height = SDL_min(CLUSTER_TILE_SIZE,
+			    c.options.height - r->y);
+		}
+	}
+
+	pid_t *children = calloc(local_count + 1, sizeof(pid_t));
+	if (children == NULL) {
+		exit(EXIT_FAILURE);
+	}
+	bool ok = spawn_workers(address, c.options.backend, c.listen_fd,
+	    children, local_count);
+
+	Uint64 start = SDL_GetTicksNS();
+	while (ok && c.written < c.rows) {
+		for (int i = 0; i < c.worker_count; ++i) {
+			dispatch(&c, i);
+		}
+
+		struct pollfd *fds = malloc((c.worker_count + 1) *
+		    sizeof(struct pollfd));
+		if (fds == NULL) {
+			exit(EXIT_FAILURE);
+		}
+		fds[0].fd = c.listen_fd;
+		fds[0].events = POLLIN;
+		for (int i = 0; i < c.worker_count; ++i) {
+			fds[i + 1].fd = c.workers[i].fd;
+			fds[i + 1].events = POLLIN;
+		}
+		int ready = poll(fds, c.worker_count + 1, 1000);
+		if (ready == -1 && errno != EINTR) {
+			exit(EXIT_FAILURE);
+		}
+		int count = c.worker_count;
+		for (int i = 0; ready > 0 && i < count; ++i) {
+			if (fds[i + 1].revents != 0 && !receive(&c, i)) {
+				drop_worker(&c, i);
+			}
+		}
+		if (ready > 0 && (fds[0].revents & POLLIN)) {
+			add_worker(&c);
+		}
+		free(fds);
+		expire_jobs(&c);
+
+		ok = write_rows(&c);
+		if (!ok) {
+			fprintf(stderr, "%s: cannot write image\n",
+			    c.options.path);
+		}
+
+		// Without a public address only local workers can connect,
+		// so the render cannot go on once they have all gone.
+		bool connected = false;
+		for (int i = 0; i < c.worker_count; ++i) {
+			connected |= c.workers[i].fd != -1;
+		}
+		if (ok && address == temporary && !connected &&
+		    !children_alive(children, local_count)) {
+			fprintf(stderr, "every worker has failed\n");
+			ok = false;
+		}
+	}
+	double seconds = (SDL_GetTicksNS() - start) / 1e9;
+
+	JobMessage quit;
+	memset(&quit, 0, sizeof(JobMessage));
+	quit.id = CLUSTER_QUIT;
+	for (int i = 0; i < c.worker_count; ++i) {
+		if (c.workers[i].fd != -1) {
+			net_write(c.workers[i].fd, &quit, sizeof(quit));
+			close(c.workers[i].fd);
+		}
+	}
+	close(c.listen_fd);
+	if (address == temporary) {
+		unlink(temporary);
+	}
+	for (int i = 0; i < local_count; ++i) {
+		// A local worker that hung would never exit on its own.
+		for (int j = 0; children[i] > 0 && j < c.worker_count; ++j) {
+			if (c.workers[j].timed_out &&
+			    c.workers[j].pid == (uint32_t)children[i]) {
+				kill(children[i], SIGKILL);
+			}
+		}
+		if (children[i] > 0) {
+			waitpid(children[i], NULL, 0);
+		}
+	}
+	if (!image_close(c.writer) && ok) {
+		ok = false;
+		fprintf(stderr, "%s: cannot write image\n", c.options.path);
+	}
+	if (ok) {
+		report(&c, seconds);
+	}
+
+	for (int i = 0; i < c.columns * c.rows; ++i) {
+		free(c.jobs[i].counts);
+	}
+	for (int i = 0; i < c.worker_count; ++i) {
+		free(c.workers[i].data);
+	}
+	free(c.workers);
+	free(c.jobs);
+	free(children);
+	free(c.pixels);
+	canvas_free(&c.band);
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Connects to a coordinator and renders the jobs it sends until it says to
+// quit or goes away.
+int
+worker_main(int argc, char **argv)
+{
+	char const *backend = "cpu";
+	int option;
+	while ((option = getopt(argc, argv, "b:")) != -1) {
+		if (option == 'b') {
+			backend = optarg;
+		} else {
+			worker_usage();
+		}
+	}
+	if (optind != argc - 1) {
+		worker_usage();
+	}
+	return run_worker(argv[optind], backend);
+}
+
+// Forks workers that connect back to the coordinator like any other.
+// Those already forked when one fails are left for the caller to reap.
+static bool
+spawn_workers(char const *address, char const *backend, int listen_fd,
+    pid_t *children, int count)
+{
+	fflush(NULL);
+	for (int i = 0; i < count; ++i) {
+		children[i] = fork();
+		if (children[i] == -1) {
+			children[i] = 0;
+			fprintf(stderr, "cannot start a local worker\n");
+			return false;
+		}
+		if (children[i] == 0) {
+			close(listen_fd);
+			_exit(run_worker(address, backend));
+		}
+	}
+	return true;
+}
+
+static bool
+children_alive(pid_t *children, int count)
+{
+	bool alive = false;
+	for (int i = 0; i < count; ++i) {
+		if (children[i] > 0 &&
+		    waitpid(children[i], NULL, WNOHANG) != 0) {
+			children[i] = 0;
+		}
+		alive |= children[i] > 0;
+	}
+	return alive;
+}
+
+static void
+add_worker(Coordinator *c)
+{
+	int fd = accept(c->listen_fd, NULL, NULL);
+	if (fd == -1) {
+		return;
+	}
+	Worker *workers = realloc(c->workers,
+	    (c->worker_count + 1) * sizeof(Worker));
+	if (workers == NULL) {
+		close(fd);
+		return;
+	}
+	c->workers = workers;
+	Worker *w = &c->workers[c->worker_count++];
+	memset(w, 0, sizeof(Worker));
+	w->fd = fd;
+	w->state = READ_HELLO;
+}
+
+// Keeps a worker's pipeline full.
+static void
+dispatch(Coordinator *c, int index)
+{
+	Worker *w = &c->workers[index];
+	while (w->fd != -1 && w->state != READ_HELLO &&
+	    w->in_flight < CLUSTER_DEPTH) {
+		int id = next_job(c);
+		if (id == -1) {
+			return;
+		}
+		Job *job = &c->jobs[id];
+		View view;
+		job_view(c, &job->rect, &view);
+		JobMessage m;
+		memset(&m, 0, sizeof(JobMessage));
+		m.id = id;
+		m.iterations = c->options.iterations;
+		m.width = job->rect.width;
+		m.height = job->rect.height;
+		m.mode = c->options.mode;
+		m.view[0] = view.x;
+		m.view[1] = view.y;
+		m.view[2] = view.width;
+		m.view[3] = view.height;
+		job->state = JOB_SENT;
+		job->worker = index;
+		++w->in_flight;
+		job->deadline = SDL_GetTicksNS() + w->in_flight * c->timeout;
+		if (!net_write(w->fd, &m, sizeof(m))) {
+			drop_worker(c, index);
+		}
+	}
+}
+
+// Returns the first queued job, unless it is so far below the last row that
+// was written that finished tiles would pile up waiting for it.
+static int
+next_job(Coordinator *c)
+{
+	int count = c->columns * c->rows;
+	while (c->cursor < count && c->jobs[c->cursor].state != JOB_QUEUED) {
+		++c->cursor;
+	}
+	for (int i = c->cursor; i < count; ++i) {
+		if (i / c->columns >= c->written + CLUSTER_WINDOW) {
+			return -1;
+		}
+		if (c->jobs[i].state == JOB_QUEUED) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+// Reads whatever a worker has sent. Returns false if it has gone away or
+// sent something that makes no sense.
+static bool
+receive(Coordinator *c, int index)
+{
+	Worker *w = &c->workers[index];
+	for (;;) {
+		uint8_t *target;
+		size_t length;
+		if (w->state == READ_HELLO) {
+			target = (uint8_t *)&w->message.hello;
+			length = sizeof(Hello);
+		} else if (w->state == READ_RESULT) {
+			target = (uint8_t *)&w->message.result;
+			length = sizeof(ResultMessage);
+		} else {
+			target = w->data;
+			length = w->message.result.length;
+		}
+		ssize_t r = recv(w->fd, target + w->got, length - w->got,
+		    MSG_DONTWAIT);
+		if (r == 0) {
+			return false;
+		}
+		if (r < 0) {
+			return errno == EAGAIN || errno == EWOULDBLOCK ||
+			    errno == EINTR;
+		}
+		w->got += r;
+		if (w->got == length) {
+			w->got = 0;
+			if (!finish_message(c, index)) {
+				return false;
+			}
+		}
+	}
+}
+
+static bool
+finish_message(Coordinator *c, int index)
+{
+	Worker *w = &c->workers[index];
+	if (w->state == READ_HELLO) {
+		Hello const *h = &w->message.hello;
+		if (memcmp(h->magic, CLUSTER_MAGIC, sizeof(h->magic)) != 0 ||
+		    h->formula != RENDER_FORMULA) {
+			fprintf(stderr, "rejected a worker with another "
+			    "protocol or iteration formula\n");
+			return false;
+		}
+		w->pid = h->pid;
+		w->state = READ_RESULT;
+		return true;
+	}
+
+	ResultMessage const *m = &w->message.result;
+	if (w->state == READ_RESULT) {
+		if (m->id >= (uint32_t)(c->columns * c->rows)) {
+			return false;
+		}
+		Job const *job = &c->jobs[m->id];
+		if (job->state != JOB_SENT || job->worker != index ||
+		    m->length == 0 || m->length > CODEC_BOUND(
+		    job->rect.width * job->rect.height)) {
+			return false;
+		}
+		w->data = malloc(m->length);
+		if (w->data == NULL) {
+			exit(EXIT_FAILURE);
+		}
+		w->state = READ_DATA;
+		return true;
+	}
+
+	Job *job = &c->jobs[m->id];
+	job->counts = malloc(CODEC_BOUND(job->rect.width *
+	    job->rect.height));
+	if (job->counts == NULL) {
+		exit(EXIT_FAILURE);
+	}
+	bool ok = codec_decode(w->data, m->length, job->rect.width,
+	    job->rect.height, job->counts);
+	free(w->data);
+	w->data = NULL;
+	w->state = READ_RESULT;
+	if (!ok) {
+		free(job->counts);
+		job->counts = NULL;
+		return false;
+	}
+	job->state = JOB_DONE;
+	--w->in_flight;
+	++w->jobs;
+	w->pixels += job->rect.width * job->rect.height;
+	w->nanoseconds += m->nanoseconds;
+
+	// Jobs are answered in order, so the next one has only now started.
+	Uint64 deadline = SDL_GetTicksNS() + c->timeout;
+	for (int i = c->written * c->columns; i < c->columns * c->rows;
+	    ++i) {
+		Job *next = &c->jobs[i];
+		if (next->state == JOB_SENT && next->worker == index) {
+			next->deadline = SDL_max(next->deadline, deadline);
+		}
+	}
+	dispatch(c, index);
+	return true;
+}
+
+// Hands out the jobs of workers that have not answered in time to the others.
+static void
+expire_jobs(Coordinator *c)
+{
+	Uint64 now = SDL_GetTicksNS();
+	for (int i = c->written * c->columns; i < c->columns * c->rows;
+	    ++i) {
+		Job const *job = &c->jobs[i];
+		if (job->state != JOB_SENT || now < job->deadline) {
+			continue;
+		}
+		Worker *w = &c->workers[job->worker];
+		fprintf(stderr, "worker %d (pid %lu) timed out\n",
+		    job->worker + 1, (unsigned long)w->pid);
+		w->timed_out = true;
+		drop_worker(c, job->worker);
+	}
+}
+
+// Closes a worker's connection and queues its unfinished jobs again.
+static void
+drop_worker(Coordinator *c, int index)
+{
+	Worker *w = &c->workers[index];
+	if (w->fd == -1) {
+		return;
+	}
+	close(w->fd);
+	w->fd = -1;
+	free(w->data);
+	w->data = NULL;
+	w->failed = true;
+
+	int requeued = 0;
+	for (int i = 0; i < c->columns * c->rows; ++i) {
+		Job *job = &c->jobs[i];
+		if (job->state == JOB_SENT && job->worker == index) {
+			job->state = JOB_QUEUED;
+			c->cursor = SDL_min(c->cursor, i);
+			++requeued;
+		}
+	}
+	w->in_flight = 0;
+	if (w->state != READ_HELLO) {
+		fprintf(stderr, "worker %d (pid %lu) failed, handing out %d "
+		    "jobs again\n", index + 1, (unsigned long)w->pid,
+		    requeued);
+	}
+}
+
+// Writes every finished row of tiles that the image has reached.
+static bool
+write_rows(Coordinator *c)
+{
+	while (c->written < c->rows) {
+		Job *row = &c->jobs[c->written * c->columns];
+		for (int x = 0; x < c->columns; ++x) {
+			if (row[x].state != JOB_DONE) {
+				return true;
+			}
+		}
+
+		c->band.height = row[0].rect.height;
+		for (int x = 0; x < c->columns; ++x) {
+			Rect const *r = &row[x].rect;
+			for (int y = 0; y < r->height; ++y) {
+				memcpy(c->band.counts + (size_t)y *
+				    c->band.width + r->x, row[x].counts +
+				    (size_t)y * r->width,
+				    r->width * sizeof(uint32_t));
+			}
+			free(row[x].counts);
+			row[x].counts = NULL;
+		}
+		Rect all = {0, 0, c->band.width, c->band.height};
+		colorize(&c->band, &all, c->pixels);
+		if (!image_write(c->writer, c->pixels, c->band.height)) {
+			return false;
+		}
+		++c->written;
+	}
+	return true;
+}
+
+// Compares the throughput of the whole render with that of each worker
+// while it was rendering.
+static void
+report(Coordinator const *c, double seconds)
+{
+	double fastest = 0.;
+	for (int i = 0; i < c->worker_count; ++i) {
+		Worker const *w = &c->workers[i];
+		if (w->state == READ_HELLO) {
+			continue;
+		}
+		double megapixels = w->pixels / 1e6;
+		double busy = w->nanoseconds / 1e9;
+		double rate = busy > 0. ? megapixels / busy : 0.;
+		fastest = SDL_max(fastest, rate);
+		fprintf(stderr, "worker %d (pid %lu)%s: %d jobs, %.1f "
+		    "megapixels in %.2f s, %.2f megapixels/s\n", i + 1,
+		    (unsigned long)w->pid, w->failed ? " failed" : "",
+		    w->jobs, megapixels, busy, rate);
+	}
+	double megapixels = (double)c->options.width * c->options.height /
+	    1e6;
+	double rate = megapixels / seconds;
+	fprintf(stderr, "%.1f megapixels in %.2f s, %.2f megapixels/s, "
+	    "%.2fx the fastest worker\n", megapixels, seconds, rate,
+	    fastest > 0. ? rate / fastest : 0.);
+}
+
+// Returns the view of a rectangle of the image's pixels.
+static void
+job_view(Coordinator const *c, Rect const *r, View *v)
+{
+	double pixel_width = 2. * c->view.width / c->options.width;
+	double pixel_height = 2. * c->view.height / c->options.height;
+	v->x = c->view.x - c->view.width + (r->x + .5 * r->width) *
+	    pixel_width;
+	v->y = c->view.y + c->view.height - (r->y + .5 * r->height) *
+	    pixel_height;
+	v->width = .5 * r->width * pixel_width;
+	v->height = .5 * r->height * pixel_height;
+}
+
+static int
+run_worker(char const *address, char const *backend)
+{
+	// The coordinator may still be starting.
+	int fd = -1;
+	for (int i = 0; i < CLUSTER_CONNECT_TRIES && fd == -1; ++i) {
+		fd = net_connect(address);
+		if (fd == -1) {
+			SDL_Delay(100);
+		}
+	}
+	if (fd == -1) {
+		fprintf(stderr, "%s: cannot connect\n", address);
+		return EXIT_FAILURE;
+	}
+	Backend *b = backend_create(backend);
+	if (b == NULL) {
+		fprintf(stderr, "%s: backend is unknown or unavailable\n",
+		    backend);
+		close(fd);
+		return EXIT_FAILURE;
+	}
+
+	Hello h;
+	memset(&h, 0, sizeof(Hello));
+	memcpy(h.magic, CLUSTER_MAGIC, sizeof(h.magic));
+	h.formula = RENDER_FORMULA;
+	h.pid = getpid();
+	bool ok = net_write(fd, &h, sizeof(h));
+
+	JobMessage m;
+	while (ok && net_read(fd, &m, sizeof(m)) && m.id != CLUSTER_QUIT) {
+		View view = {m.view[0], m.view[1], m.view[2], m.view[3]};
+		Canvas canvas;
+		ok = m.width > 0 && m.width <= CLUSTER_TILE_SIZE &&
+		    m.height > 0 && m.height <= CLUSTER_TILE_SIZE &&
+		    m.mode <= RENDER_MODE_GUESS && canvas_init(&canvas,
+		    &view, m.iterations, m.width, m.height);
+		if (!ok) {
+			break;
+		}
+
+		Uint64 start = SDL_GetTicksNS();
+		ok = backend_render(b, &canvas, m.mode);
+		ResultMessage r;
+		r.id = m.id;
+		r.nanoseconds = SDL_GetTicksNS() - start;
+		uint8_t *data = malloc(CODEC_BOUND(m.width * m.height));
+		if (ok && data != NULL) {
+			r.length = codec_encode(canvas.counts, m.width,
+			    m.height, data);
+			ok = net_write(fd, &r, sizeof(r)) &&
+			    net_write(fd, data, r.length);
+		}
+		free(data);
+		canvas_free(&canvas);
+	}
+	backend_destroy(b);
+	close(fd);
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static void
+coordinator_usage(void)
+{
+	fprintf(stderr, "usage: mandelbrot coordinator [-b cpu|gpu] [-c x,y] "
+	    "[-s scale] [-g WIDTHxHEIGHT]\n"
+	    "                              [-i iterations] "
+	    "[-m brute|trace|guess] [-l address]\n"
+	    "                              [-t seconds] [-w local-workers] "
+	    "-o file\n");
+	exit(EXIT_FAILURE);
+}
+
+static void
+worker_usage(void)
+{
+	fprintf(stderr, "usage: mandelbrot worker [-b cpu|gpu] address\n");
+	exit(EXIT_FAILURE);
+}
@@ -0,0 +1,245 @@
+// Copyright (c) 2025 Charles Hood <chood@chood.net>
+//
+// This program is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL3/SDL.h>
+#include "cache.h"
+#include "check.h"
+#include "codec.h"
+
+#define CODEC_MAX_TOKEN 5
+#define CODEC_COLUMNS 5
+#define CODEC_ROWS 3
+#define CODEC_ROUNDS 20
+
+static size_t put_varint(uint8_t *, uint32_t);
+static size_t get_varint(uint8_t const *, size_t, uint32_t *);
+
+// Encodes width * height counts as differences from a prediction, the pixel
+// to the left or, at the start of a row, the one above. Each difference is
+// zigzag-encoded into a variable-length integer, except that a zero starts a
+// run, followed by the number of further zero differences. Neighboring pixels
+// mostly share their counts, so most of a tile becomes a few runs.
+//
+// Returns the length of the encoding, which is the raw counts if encoding
+// would not make them smaller.
+size_t
+codec_encode(uint32_t const *counts, int width, int height, uint8_t *out)
+{
+	size_t bound = CODEC_BOUND((size_t)width * height), length = 0;
+	uint32_t run = 0;
+	for (int y = 0; y < height; ++y) {
+		uint32_t const *row = counts + (size_t)y * width;
+		uint32_t last = y > 0 ? row[-width] : 0;
+		for (int x = 0; x < width; ++x) {
+			uint32_t d = row[x] - last;
+			last = row[x];
+			if (d == 0) {
+				++run;
+				continue;
+			}
+			if (length + 3 * CODEC_MAX_TOKEN >= bound) {
+				memcpy(out, counts, bound);
+				return bound;
+			}
+			if (run != 0) {
+				length += put_varint(out + length, 0);
+				length += put_varint(out + length, run - 1);
+				run = 0;
+			}
+			length += put_varint(out + length,
+			    d << 1 ^ (0u - (d >> 31)));
+		}
+	}
+	if (run != 0) {
+		if (length + 2 * CODEC_MAX_TOKEN >= bound) {
+			memcpy(out, counts, bound);
+			return bound;
+		}
+		length += put_varint(out + length, 0);
+		length += put_varint(out + length, run - 1);
+	}
+	return length;
+}
+
+// Returns false if the encoding is damaged.
+bool
+codec_decode(uint8_t const *in, size_t length, int width, int height,
+    uint32_t *counts)
+{
+	size_t n = (size_t)width * height;
+	if (length == CODEC_BOUND(n)) {
+		memcpy(counts, in, length);
+		return true;
+	}
+
+	size_t p = 0;
+	uint32_t run = 0;
+	for (int y = 0; y < height; ++y) {
+		uint32_t *row = counts + (size_t)y * width;
+		uint32_t last = y > 0 ? row[-width] : 0;
+		for (int x = 0; x < width;) {
+			if (run == 0) {
+				uint32_t token;
+				size_t k = get_varint(in + p, length - p,
+				    &token);
+				if (k == 0) {
+					return false;
+				}
+				p += k;
+				if (token != 0) {
+					last += token >> 1 ^ (0u - (token & 1));
+					row[x++] = last;
+					continue;
+				}
+				k = get_varint(in + p, length - p, &run);
+				size_t left = n - ((size_t)y * width + x);
+				if (k == 0 || run >= left) {
+					return false;
+				}
+				p += k;
+				++run;
+			}
+			uint32_t fill = (uint32_t)(width - x) < run ?
+			    (uint32_t)(width - x) : run;
+			for (uint32_t j = 0; j < fill; ++j) {
+				row[x + j] = last;
+			}
+			x += fill;
+			run -= fill;
+		}
+	}
+	return p == length;
+}
+
+// Measures how well tiles of the reference views compress and how fast they
+// are encoded and decoded.
+int
+codec_main(int argc, char **argv)
+{
+	(void)argv;
+	if (argc != 1) {
+		fprintf(stderr, "usage: mandelbrot codec\n");
+		return EXIT_FAILURE;
+	}
+
+	int width = CODEC_COLUMNS * TILE_SIZE, height = CODEC_ROWS * TILE_SIZE;
+	int tile_count = CODEC_COLUMNS * CODEC_ROWS;
+	size_t tile_length = CODEC_BOUND(TILE_SIZE * TILE_SIZE);
+	uint32_t *tiles = malloc(tile_count * tile_length);
+	uint32_t *decoded = malloc(tile_length);
+	uint8_t *encoded = malloc(tile_count * tile_length);
+	size_t *lengths = malloc(tile_count * sizeof(size_t));
+	if (tiles == NULL || decoded == NULL || encoded == NULL ||
+	    lengths == NULL) {
+		exit(EXIT_FAILURE);
+	}
+
+	bool ok = true;
+	for (int i = 0; i < reference_view_count; ++i) {
+		ReferenceView const *ref = &reference_views[i];
+		View view;
+		Canvas c;
+		fit_view(&ref->view, width, height, &view);
+		if (!canvas_init(&c, &view, ref->iterations, width, height)) {
+			exit(EXIT_FAILURE);
+		}
+		Rect all = {0, 0, width, height};
+		render(&c, &all, RENDER_MODE_TRACE, NULL);
+		for (int t = 0; t < tile_count; ++t) {
+			uint32_t *tile = tiles + (size_t)t * TILE_SIZE *
+			    TILE_SIZE;
+			int x = t % CODEC_COLUMNS * TILE_SIZE;
+			int y = t / CODEC_COLUMNS * TILE_SIZE;
+			for (int j = 0; j < TILE_SIZE; ++j) {
+				memcpy(tile + j * TILE_SIZE, c.counts +
+				    (size_t)(y + j) * width + x,
+				    TILE_SIZE * sizeof(uint32_t));
+			}
+		}
+		canvas_free(&c);
+
+		size_t raw = 0, total = 0;
+		Uint64 start = SDL_GetTicksNS();
+		for (int round = 0; round < CODEC_ROUNDS; ++round) {
+			raw = total = 0;
+			for (int t = 0; t < tile_count; ++t) {
+				lengths[t] = codec_encode(tiles + (size_t)t *
+				    TILE_SIZE * TILE_SIZE, TILE_SIZE,
+				    TILE_SIZE, encoded + t * tile_length);
+				raw += tile_length;
+				total += lengths[t];
+			}
+		}
+		double encode_time = (SDL_GetTicksNS() - start) / 1e9;
+
+		start = SDL_GetTicksNS();
+		for (int round = 0; round < CODEC_ROUNDS; ++round) {
+			for (int t = 0; t < tile_count; ++t) {
+				ok &= codec_decode(encoded + t * tile_length,
+				    lengths[t], TILE_SIZE, TILE_SIZE, decoded);
+				if (round == 0) {
+					ok &= memcmp(decoded, tiles +
+					    (size_t)t * TILE_SIZE * TILE_SIZE,
+					    tile_length) == 0;
+				}
+			}
+		}
+		double decode_time = (SDL_GetTicksNS() - start) / 1e9;
+
+		double megabytes = (double)raw * CODEC_ROUNDS / (1 << 20);
+		printf("%-10s %6.2fx smaller, encode %7.1f MiB/s, decode "
+		    "%7.1f MiB/s\n", ref->name, (double)raw / total,
+		    megabytes / encode_time, megabytes / decode_time);
+	}
+	free(tiles);
+	free(decoded);
+	free(encoded);
+	free(lengths);
+	if (!ok) {
+		fprintf(stderr, "codec: decoded tiles differ\n");
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
+
+static size_t
+put_varint(uint8_t *out, uint32_t v)
+{
+	size_t n = 0;
+	while (v >= 0x80) {
+		out[n++] = v | 0x80;
+		v >>= 7;
+	}
+	out[n++] = v;
+	return n;
+}
+
+// Returns the number of bytes read, or zero if the integer is cut off or
+// too long.
+static size_t
+get_varint(uint8_t const *in, size_t length, uint32_t *v)
+{
+	*v = 0;
+	for (size_t n = 0; n < length && n < CODEC_MAX_TOKEN; ++n) {
+		*v |= (uint32_t)(in[n] & 0x7f) << 7 * n;
+		if (!(in[n] & 0x80)) {
+			return n + 1;
+		}
+	}
+	return 0;
+}
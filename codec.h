@@ -0,0 +1,30 @@
+// Copyright (c) 2025 Charles Hood <chood@chood.net>
+//
+// This program is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef CODEC_H
+#define CODEC_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// The largest encoding of n counts, which is their raw size.
+#define CODEC_BOUND(n) ((size_t)(n) * sizeof(uint32_t))
+
+size_t codec_encode(uint32_t const *, int, int, uint8_t *);
+bool codec_decode(uint8_t const *, size_t, int, int, uint32_t *);
+int codec_main(int, char **);
+
+#endif
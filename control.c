@@ -0,0 +1,284 @@
+// Copyright (c) 2025 Charles Hood <chood@chood.net>
+//
+// This program is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <poll.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "control.h"
+#include "net.h"
+
+#define CONTROL_LINE_BYTES 1024
+
+// A client is shared by the thread that reads from it and by every command
+// it has sent, and closed once the last of them lets go.
+struct ControlClient {
+	int fd;
+	SDL_AtomicInt references;
+	char line[CONTROL_LINE_BYTES];
+	size_t used;
+};
+
+typedef struct Queued Queued;
+struct Queued {
+	ControlCommand command;
+	Queued *next;
+};
+
+// Clients are read by a thread of their own, which queues every line they
+// send and wakes up the event loop with an event of the given type. The
+// event loop takes commands off the queue whenever it likes, so that it can
+// apply many at once.
+struct Control {
+	int listen_fd;
+	Uint32 event_type;
+	SDL_Mutex *mutex;
+	Queued *head;
+	Queued *tail;
+	ControlClient **clients;
+	int client_count;
+	SDL_Thread *thread;
+};
+
+static int run_control(void *);
+static bool read_client(Control *, ControlClient *);
+static void push_line(Control *, ControlClient *, char const *);
+
+// Listens on a Unix socket at the given path. Returns NULL on failure.
+Control *
+control_open(char const *path, Uint32 event_type)
+{
+	if (strchr(path, '/') == NULL) {
+		return NULL;
+	}
+	Control *c = calloc(1, sizeof(Control));
+	if (c == NULL) {
+		return NULL;
+	}
+	c->event_type = event_type;
+	c->mutex = SDL_CreateMutex();
+	c->listen_fd = net_listen(path);
+	if (c->mutex == NULL || c->listen_fd == -1) {
+		SDL_DestroyMutex(c->mutex);
+		free(c);
+		return NULL;
+	}
+	c->thread = SDL_CreateThread(run_control, "control", c);
+	if (c->thread == NULL) {
+		close(c->listen_fd);
+		SDL_DestroyMutex(c->mutex);
+		free(c);
+		return NULL;
+	}
+	return c;
+}
+
+// Takes the oldest queued command, returning false if there is none.
+bool
+control_next(Control *c, ControlCommand *command)
+{
+	SDL_LockMutex(c->mutex);
+	Queued *q = c->head;
+	if (q != NULL) {
+		c->head = q->next;
+		if (c->head == NULL) {
+			c->tail = NULL;
+		}
+	}
+	SDL_UnlockMutex(c->mutex);
+	if (q == NULL) {
+		return false;
+	}
+	*command = q->command;
+	free(q);
+	return true;
+}
+
+bool
+control_pending(Control *c)
+{
+	SDL_LockMutex(c->mutex);
+	bool pending = c->head != NULL;
+	SDL_UnlockMutex(c->mutex);
+	return pending;
+}
+
+// Sends a line, to which a newline is added.
+bool
+control_reply(ControlCommand const *command, char const *format, ...)
+{
+	char line[CONTROL_LINE_BYTES];
+	va_list ap;
+	va_start(ap, format);
+	int n = vsnprintf(line, sizeof(line) - 1, format, ap);
+	va_end(ap);
+	if (n < 0) {
+		return false;
+	}
+	n = SDL_min(n, (int)sizeof(line) - 2);
+	line[n++] = '\n';
+	return control_send(command, line, n);
+}
+
+bool
+control_send(ControlCommand const *command, void const *data, size_t length)
+{
+	return net_write(command->client->fd, data, length);
+}
+
+void
+control_release(ControlCommand *command)
+{
+	free(command->line);
+	ControlClient *client = command->client;
+	if (SDL_AddAtomicInt(&client->references, -1) == 1) {
+		close(client->fd);
+		free(client);
+	}
+}
+
+static int
+run_control(void *data)
+{
+	Control *c = data;
+	for (;;) {
+		SDL_LockMutex(c->mutex);
+		int count = c->client_count;
+		struct pollfd *fds = malloc((count + 1) *
+		    sizeof(struct pollfd));
+		if (fds == NULL) {
+			SDL_UnlockMutex(c->mutex);
+			return 0;
+		}
+		fds[0].fd = c->listen_fd;
+		fds[0].events = POLLIN;
+		for (int i = 0; i < count; ++i) {
+			fds[i + 1].fd = c->clients[i]->fd;
+			fds[i + 1].events = POLLIN;
+		}
+		SDL_UnlockMutex(c->mutex);
+
+		if (poll(fds, count + 1, -1) == -1 && errno != EINTR) {
+			free(fds);
+			return 0;
+		}
+		// Clients are only added and removed by this thread, so the
+		// ones that were polled are still in place.
+		for (int i = count - 1; i >= 0; --i) {
+			if (fds[i + 1].revents != 0 &&
+			    !read_client(c, c->clients[i])) {
+				ControlCommand gone = {c->clients[i], NULL};
+				control_release(&gone);
+				SDL_LockMutex(c->mutex);
+				c->clients[i] = c->clients[--c->client_count];
+				SDL_UnlockMutex(c->mutex);
+			}
+		}
+		if (fds[0].revents & POLLIN) {
+			int fd = accept(c->listen_fd, NULL, NULL);
+			ControlClient *client = calloc(1,
+			    sizeof(ControlClient));
+			ControlClient **clients = realloc(c->clients,
+			    (count + 1) * sizeof(ControlClient *));
+			if (fd != -1 && client != NULL && clients != NULL) {
+				client->fd = fd;
+				SDL_SetAtomicInt(&client->references, 1);
+				SDL_LockMutex(c->mutex);
+				c->clients = clients;
+				c->clients[c->client_count++] = client;
+				SDL_UnlockMutex(c->mutex);
+			} else {
+				if (fd != -1) {
+					close(fd);
+				}
+				free(client);
+				if (clients != NULL) {
+					c->clients = clients;
+				}
+			}
+		}
+		free(fds);
+	}
+}
+
+// Queues every complete line that a client has sent. Returns false once the
+// client has gone away or sent a line that is too long.
+static bool
+read_client(Control *c, ControlClient *client)
+{
+	ssize_t r = recv(client->fd, client->line + client->used,
+	    sizeof(client->line) - client->used, 0);
+	if (r <= 0) {
+		return r < 0 && errno == EINTR;
+	}
+	client->used += r;
+
+	bool queued = false;
+	char *start = client->line, *end;
+	while ((end = memchr(start, '\n', client->line + client->used -
+	    start)) != NULL) {
+		*end = '\0';
+		if (end > start && end[-1] == '\r') {
+			end[-1] = '\0';
+		}
+		if (*start != '\0') {
+			push_line(c, client, start);
+			queued = true;
+		}
+		start = end + 1;
+	}
+	client->used -= start - client->line;
+	memmove(client->line, start, client->used);
+
+	if (queued) {
+		SDL_Event e;
+		SDL_zero(e);
+		e.type = c->event_type;
+		SDL_PushEvent(&e);
+	}
+	return client->used < sizeof(client->line);
+}
+
+static void
+push_line(Control *c, ControlClient *client, char const *line)
+{
+	Queued *q = malloc(sizeof(Queued));
+	char *copy = malloc(strlen(line) + 1);
+	if (q == NULL || copy == NULL) {
+		free(q);
+		free(copy);
+		return;
+	}
+	strcpy(copy, line);
+	SDL_AddAtomicInt(&client->references, 1);
+	q->command.client = client;
+	q->command.line = copy;
+	q->next = NULL;
+
+	SDL_LockMutex(c->mutex);
+	if (c->tail == NULL) {
+		c->head = q;
+	} else {
+		c->tail->next = q;
+	}
+	c->tail = q;
+	SDL_UnlockMutex(c->mutex);
+}
@@ -0,0 +1,40 @@
+// Copyright (c) 2025 Charles Hood <chood@chood.net>
+//
+// This program is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef CONTROL_H
+#define CONTROL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <SDL3/SDL.h>
+
+typedef struct Control Control;
+typedef struct ControlClient ControlClient;
+
+// A line received from a client, which is answered through the client and
+// released with control_release().
+typedef struct {
+	ControlClient *client;
+	char *line;
+} ControlCommand;
+
+Control *control_open(char const *, Uint32);
+bool control_next(Control *, ControlCommand *);
+bool control_pending(Control *);
+bool control_reply(ControlCommand const *, char const *, ...);
+bool control_send(ControlCommand const *, void const *, size_t);
+void control_release(ControlCommand *);
+
+#endif
@@ -0,0 +1,459 @@
+// Copyright (c) 2025 Charles Hood <chood@chood.net>
+//
+// This program is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <GLES3/gl3.h>
+#include <SDL3/SDL.h>
+#include "gpu.h"
+#include "headless.h"
+#include "image.h"
+#include "movie.h"
+#include "pool.h"
+#include "shader.h"
+
+#define EXPMAP_BAND_ROWS 16
+
+// A zoom into a fixed center rendered once as an exponential map: column i of
+// the strip is at angle 2 pi (i + .5) / columns around the center and row j at
+// radius exp(log_min + (j + .5) * log_step), with log_step equal to the
+// angular step so that strip pixels are square. The strip covers every point
+// of every frame outside the final view, which is rendered normally.
+typedef struct {
+	RenderOptions options;
+	double start_scale;
+	int frames;
+	Canvas final;
+	int columns;
+	int rows;
+	double log_min;
+	double log_step;
+	uint32_t *strip;
+} Expmap;
+
+typedef struct {
+	Expmap *expmap;
+	View view;
+	Canvas *canvas;
+	int y;
+} Band;
+
+// Draws a frame from the strip and the final view on the GPU. The offsets
+// from the center are small, so single precision is enough here.
+typedef struct {
+	Gpu *gpu;
+	GLuint program;
+	GLint transformation_uniform;
+	GLint final_size_uniform;
+	GLint log_min_uniform;
+	GLint log_step_uniform;
+	GLint iterations_uniform;
+	GLuint textures[2];
+	GLuint framebuffer;
+	GLuint renderbuffer;
+	GLuint vertex_array;
+	uint8_t *pixels;
+} Reconstruction;
+
+static void render_strip_band(void *);
+static void reconstruct_band(void *);
+static bool gpu_init(Reconstruction *, Expmap const *);
+static void gpu_reconstruct(Reconstruction *, Expmap const *, View const *,
+    uint8_t *);
+static void gpu_free(Reconstruction *);
+static void usage(void);
+
+static char const expmap_frag_shader_source[] = "\
+#version 300 es\n\
+precision highp float;\n\
+precision highp int;\n\
+precision highp usampler2D;\n\
+\n\
+uniform usampler2D strip;\n\
+uniform usampler2D final_view;\n\
+uniform vec2 final_size;\n\
+uniform float log_min;\n\
+uniform float log_step;\n\
+uniform uint iterations;\n\
+\n\
+in vec2 frag_position;\n\
+\n\
+out vec4 out_color;\n\
+\n\
+void\n\
+main()\n\
+{\n\
+	vec2 d = frag_position;\n\
+\n\
+	uint count;\n\
+	if (abs(d.x) < final_size.x && abs(d.y) < final_size.y) {\n\
+		ivec2 size = textureSize(final_view, 0);\n\
+		vec2 uv = (d / final_size + 1.) * .5;\n\
+		ivec2 p = ivec2(uv.x * float(size.x),\n\
+		    (1. - uv.y) * float(size.y));\n\
+		count = texelFetch(final_view, clamp(p, ivec2(0), size - 1),\n\
+		    0).r;\n\
+	} else {\n\
+		ivec2 size = textureSize(strip, 0);\n\
+		float angle = atan(d.y, d.x) + 3.14159265;\n\
+		ivec2 p = ivec2(angle / 6.28318531 * float(size.x),\n\
+		    (log(length(d)) - log_min) / log_step);\n\
+		count = texelFetch(strip, clamp(p, ivec2(0), size - 1), 0).r;\n\
+	}\n\
+\n\
+	out_color = vec4(0., 0., 127. / 255., 1.);\n\
+	if (count >= iterations) {\n\
+		out_color = vec4(1.);\n\
+	}\n\
+}\n\
+";
+
+// Renders a zoom into the center given by -c like the movie command, but
+// only renders the strip and the final view and reconstructs every frame
+// from them, on the CPU or with OpenGL ES. All frames share the center.
+int
+expmap_main(int argc, char **argv)
+{
+	Expmap e;
+	render_options_init(&e.options);
+	e.options.focus.x = -.743643887037151;
+	e.options.focus.y = .131825904205330;
+	e.options.focus.width = e.options.focus.height = 1e-4;
+	e.start_scale = 1.25;
+	e.frames = 300;
+	int fps = 30;
+	int c;
+	while ((c = getopt(argc, argv, "S:b:c:g:i:m:n:r:s:")) != -1) {
+		char *end;
+		switch (c) {
+		case 'S':
+			e.start_scale = strtod(optarg, &end);
+			if (end == optarg || *end != '\0' ||
+			    !(e.start_scale > 0.)) {
+				usage();
+			}
+			break;
+		case 'n':
+			e.frames = atoi(optarg);
+			if (e.frames <= 0) {
+				usage();
+			}
+			break;
+		case 'r':
+			fps = atoi(optarg);
+			if (fps <= 0) {
+				usage();
+			}
+			break;
+		default:
+			if (!render_options_parse(&e.options, c, optarg)) {
+				usage();
+			}
+		}
+	}
+	if (optind != argc) {
+		usage();
+	}
+	if (e.start_scale <= e.options.focus.height) {
+		fprintf(stderr, "mandelbrot: the start scale has to be larger "
+		    "than the final scale\n");
+		return EXIT_FAILURE;
+	}
+	if (isatty(STDOUT_FILENO)) {
+		fprintf(stderr, "mandelbrot: not writing a movie to a "
+		    "terminal\n");
+		return EXIT_FAILURE;
+	}
+
+	int width = e.options.width, height = e.options.height;
+	View from = e.options.focus, start, end;
+	from.width = from.height = e.start_scale;
+	fit_view(&from, width, height, &start);
+	fit_view(&e.options.focus, width, height, &end);
+
+	// Strip pixels match frame pixels in the corners, where the angular
+	// step is the coarsest.
+	e.columns = ceil(SDL_PI_D * hypot(width, height));
+	e.log_step = 2. * SDL_PI_D / e.columns;
+	e.log_min = log(SDL_min(end.width, end.height));
+	double log_max = log(hypot(start.width, start.height));
+	e.rows = SDL_max(1, (int)ceil((log_max - e.log_min) / e.log_step));
+	e.strip = malloc((size_t)e.columns * e.rows * sizeof(uint32_t));
+	if (e.strip == NULL || !canvas_init(&e.final, &end,
+	    e.options.iterations, width, height)) {
+		exit(EXIT_FAILURE);
+	}
+
+	Uint64 start_time = SDL_GetTicksNS();
+	Pool *pool = pool_create(0);
+	if (pool == NULL) {
+		exit(EXIT_FAILURE);
+	}
+	int band_count = (e.rows + EXPMAP_BAND_ROWS - 1) / EXPMAP_BAND_ROWS;
+	Band *bands = malloc(SDL_max(band_count, height) * sizeof(Band));
+	if (bands == NULL) {
+		exit(EXIT_FAILURE);
+	}
+	for (int i = 0; i < band_count; ++i) {
+		bands[i].expmap = &e;
+		bands[i].y = i * EXPMAP_BAND_ROWS;
+		pool_submit(pool, render_strip_band, &bands[i]);
+	}
+	Rect all = {0, 0, width, height};
+	render(&e.final, &all, e.options.mode, NULL);
+	pool_wait(pool);
+	double render_time = (SDL_GetTicksNS() - start_time) / 1e9;
+
+	Reconstruction r;
+	memset(&r, 0, sizeof(Reconstruction));
+	if (strcmp(e.options.backend, "gpu") == 0) {
+		if (!gpu_init(&r, &e)) {
+			fprintf(stderr, "gpu: backend is unavailable\n");
+			return EXIT_FAILURE;
+		}
+	} else if (strcmp(e.options.backend, "cpu") != 0) {
+		usage();
+	}
+
+	Canvas frame;
+	uint8_t *rgba = malloc((size_t)width * height * 4);
+	uint8_t *yuv = malloc((size_t)width * height * 3);
+	if (rgba == NULL || yuv == NULL || !canvas_init(&frame, &end,
+	    e.options.iterations, width, height)) {
+		exit(EXIT_FAILURE);
+	}
+	if (!y4m_write_header(stdout, width, height, fps)) {
+		exit(EXIT_FAILURE);
+	}
+	for (int i = 0; i < e.frames; ++i) {
+		View focus, view;
+		double t = e.frames > 1 ? (double)i / (e.frames - 1) : 0.;
+		zoom_focus(&from, &e.options.focus, t, &focus);
+		fit_view(&focus, width, height, &view);
+
+		if (r.gpu != NULL) {
+			gpu_reconstruct(&r, &e, &view, rgba);
+		} else {
+			band_count = (height + EXPMAP_BAND_ROWS - 1) /
+			    EXPMAP_BAND_ROWS;
+			for (int j = 0; j < band_count; ++j) {
+				bands[j].expmap = &e;
+				bands[j].view = view;
+				bands[j].canvas = &frame;
+				bands[j].y = j * EXPMAP_BAND_ROWS;
+				pool_submit(pool, reconstruct_band, &bands[j]);
+			}
+			pool_wait(pool);
+			colorize(&frame, &all, rgba);
+		}
+		rgba_to_yuv(rgba, width, height, yuv);
+		if (!y4m_write_frame(stdout, yuv, width, height)) {
+			fprintf(stderr, "mandelbrot: cannot write frame\n");
+			return EXIT_FAILURE;
+		}
+	}
+	if (fflush(stdout) != 0) {
+		return EXIT_FAILURE;
+	}
+	double seconds = (SDL_GetTicksNS() - start_time) / 1e9;
+	double rendered = (double)e.columns * e.rows +
+	    (double)width * height;
+	fprintf(stderr, "%d frames in %.2f s (%.2f s rendering), %.1f "
+	    "megapixels rendered instead of %.1f\n", e.frames, seconds,
+	    render_time, rendered / 1e6,
+	    (double)width * height * e.frames / 1e6);
+
+	if (r.gpu != NULL) {
+		gpu_free(&r);
+	}
+	pool_destroy(pool);
+	canvas_free(&frame);
+	canvas_free(&e.final);
+	free(e.strip);
+	free(bands);
+	free(rgba);
+	free(yuv);
+	return EXIT_SUCCESS;
+}
+
+static void
+render_strip_band(void *data)
+{
+	Band *b = data;
+	Expmap *e = b->expmap;
+	View const *center = &e->options.focus;
+	int end = SDL_min(b->y + EXPMAP_BAND_ROWS, e->rows);
+	for (int y = b->y; y < end; ++y) {
+		double radius = exp(e->log_min + (y + .5) * e->log_step);
+		uint32_t *row = e->strip + (size_t)y * e->columns;
+		for (int x = 0; x < e->columns; ++x) {
+			double angle = 2. * SDL_PI_D * (x + .5) / e->columns -
+			    SDL_PI_D;
+			row[x] = iterate(center->x + radius * cos(angle),
+			    center->y + radius * sin(angle),
+			    e->options.iterations);
+		}
+	}
+}
+
+// Looks up the counts of a band of rows of a frame in the final view or the
+// strip, whichever covers each pixel.
+static void
+reconstruct_band(void *data)
+{
+	Band *b = data;
+	Expmap *e = b->expmap;
+	Canvas *c = b->canvas;
+	View const *f = &e->final.view;
+	int end = SDL_min(b->y + EXPMAP_BAND_ROWS, c->height);
+	for (int y = b->y; y < end; ++y) {
+		uint32_t *row = c->counts + (size_t)y * c->width;
+		double dy = b->view.height * (1. - 2. * (y + .5) / c->height);
+		for (int x = 0; x < c->width; ++x) {
+			double dx = b->view.width *
+			    (2. * (x + .5) / c->width - 1.);
+			if (fabs(dx) < f->width && fabs(dy) < f->height) {
+				int fx = (dx / f->width + 1.) * .5 *
+				    e->final.width;
+				int fy = (1. - dy / f->height) * .5 *
+				    e->final.height;
+				fx = SDL_clamp(fx, 0, e->final.width - 1);
+				fy = SDL_clamp(fy, 0, e->final.height - 1);
+				row[x] = e->final.counts[(size_t)fy *
+				    e->final.width + fx];
+				continue;
+			}
+			int sx = (atan2(dy, dx) + SDL_PI_D) / (2. * SDL_PI_D) *
+			    e->columns;
+			int sy = (log(hypot(dx, dy)) - e->log_min) /
+			    e->log_step;
+			sx = SDL_clamp(sx, 0, e->columns - 1);
+			sy = SDL_clamp(sy, 0, e->rows - 1);
+			row[x] = e->strip[(size_t)sy * e->columns + sx];
+		}
+	}
+}
+
+static bool
+gpu_init(Reconstruction *r, Expmap const *e)
+{
+	r->gpu = gpu_create();
+	if (r->gpu == NULL) {
+		return false;
+	}
+	GLint max_size;
+	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_size);
+	r->program = create_program(vert_shader_source,
+	    expmap_frag_shader_source);
+	r->pixels = malloc((size_t)e->final.width * e->final.height * 4);
+	if (e->columns > max_size || e->rows > max_size ||
+	    r->program == 0 || r->pixels == NULL) {
+		gpu_free(r);
+		return false;
+	}
+	r->transformation_uniform =
+	    glGetUniformLocation(r->program, "transformation");
+	r->final_size_uniform = glGetUniformLocation(r->program,
+	    "final_size");
+	r->log_min_uniform = glGetUniformLocation(r->program, "log_min");
+	r->log_step_uniform = glGetUniformLocation(r->program, "log_step");
+	r->iterations_uniform = glGetUniformLocation(r->program,
+	    "iterations");
+	glUseProgram(r->program);
+	glUniform1i(glGetUniformLocation(r->program, "strip"), 0);
+	glUniform1i(glGetUniformLocation(r->program, "final_view"), 1);
+
+	glGenTextures(2, r->textures);
+	uint32_t const *data[2] = {e->strip, e->final.counts};
+	int sizes[2][2] = {
+		{e->columns, e->rows},
+		{e->final.width, e->final.height},
+	};
+	for (int i = 0; i < 2; ++i) {
+		glActiveTexture(GL_TEXTURE0 + i);
+		glBindTexture(GL_TEXTURE_2D, r->textures[i]);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+		    GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER,
+		    GL_NEAREST);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_R32UI, sizes[i][0],
+		    sizes[i][1], 0, GL_RED_INTEGER, GL_UNSIGNED_INT, data[i]);
+	}
+
+	glGenRenderbuffers(1, &r->renderbuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, r->renderbuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, e->final.width,
+	    e->final.height);
+	glGenFramebuffers(1, &r->framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, r->framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+	    GL_RENDERBUFFER, r->renderbuffer);
+	glGenVertexArrays(1, &r->vertex_array);
+	glBindVertexArray(r->vertex_array);
+	glViewport(0, 0, e->final.width, e->final.height);
+	return glCheckFramebufferStatus(GL_FRAMEBUFFER) ==
+	    GL_FRAMEBUFFER_COMPLETE && glGetError() == GL_NO_ERROR;
+}
+
+static void
+gpu_reconstruct(Reconstruction *r, Expmap const *e, View const *view,
+    uint8_t *rgba)
+{
+	glUniform4f(r->transformation_uniform, 0., 0., view->width,
+	    view->height);
+	glUniform2f(r->final_size_uniform, e->final.view.width,
+	    e->final.view.height);
+	glUniform1f(r->log_min_uniform, e->log_min);
+	glUniform1f(r->log_step_uniform, e->log_step);
+	glUniform1ui(r->iterations_uniform, e->options.iterations);
+	glDrawArrays(GL_TRIANGLES, 0, 6);
+
+	int width = e->final.width, height = e->final.height;
+	glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE,
+	    r->pixels);
+	for (int y = 0; y < height; ++y) {
+		memcpy(rgba + (size_t)y * width * 4, r->pixels +
+		    (size_t)(height - 1 - y) * width * 4, (size_t)width * 4);
+	}
+}
+
+static void
+gpu_free(Reconstruction *r)
+{
+	glDeleteVertexArrays(1, &r->vertex_array);
+	glDeleteFramebuffers(1, &r->framebuffer);
+	glDeleteRenderbuffers(1, &r->renderbuffer);
+	glDeleteTextures(2, r->textures);
+	glDeleteProgram(r->program);
+	gpu_destroy(r->gpu);
+	r->gpu = NULL;
+	free(r->pixels);
+}
+
+static void
+usage(void)
+{
+	fprintf(stderr, "usage: mandelbrot expmap [-b cpu|gpu] "
+	    "[-S start-scale] [-c x,y] [-s scale]\n"
+	    "                         [-n frames] [-r fps] [-g WIDTHxHEIGHT] "
+	    "[-i iterations]\n"
+	    "                         [-m brute|trace|guess]\n");
+	exit(EXIT_FAILURE);
+}
@@ -0,0 +1,325 @@
+// Copyright (c) 2025 Charles Hood <chood@chood.net>
+//
+// This program is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <SDL3/SDL.h>
+#include "backend.h"
+#include "check.h"
+#include "codec.h"
+#include "golden.h"
+
+#define GOLDEN_MAGIC "MBGOLDN1"
+#define GOLDEN_WIDTH 320
+#define GOLDEN_HEIGHT 200
+#define GOLDEN_PATH_BYTES 256
+
+// A golden file is this header followed by the counts of a reference view,
+// rendered by brute force on the CPU and encoded by codec_encode(), in host
+// byte order.
+typedef struct {
+	char magic[8];
+	uint32_t formula;
+	uint32_t iterations;
+	uint32_t width;
+	uint32_t height;
+	uint32_t length;
+	uint32_t reserved;
+	double view[4];
+} Header;
+
+// A backend and mode that is tested, and the share of pixels that may fail
+// to match the golden counts, or zero if every count has to be equal.
+typedef struct {
+	char const *backend;
+	RenderMode mode;
+	double tolerance;
+} Case;
+
+static bool update_golden(char const *, ReferenceView const *);
+static bool read_golden(char const *, ReferenceView const *, Canvas *);
+static bool run_case(Backend *, Case const *, ReferenceView const *,
+    Canvas const *);
+static bool matches(Canvas const *, Canvas const *, int, int);
+static bool resolvable(View const *, int);
+static void golden_path(char *, char const *, char const *);
+static void usage(void);
+
+// Renders the reference views with every backend and mode and compares them
+// with stored golden counts, so that changes to the renderers can be checked
+// against known-good output. Brute force and boundary tracing are exact and
+// have to reproduce every count.
+//
+// Solid guessing can miss details smaller than its blocks, and the GPU
+// iterates in single precision, so for them a pixel matches if its count
+// equals the golden count of the same pixel or of one of its eight neighbors,
+// which allows an escape boundary to move by a pixel, and a case passes if
+// few enough pixels fail to match.
+int
+golden_main(int argc, char **argv)
+{
+	static Case const cases[] = {
+		{"cpu", RENDER_MODE_BRUTE, 0.},
+		{"cpu", RENDER_MODE_TRACE, 0.},
+		{"cpu", RENDER_MODE_GUESS, .01},
+		{"gpu", RENDER_MODE_BRUTE, .05},
+	};
+	int case_count = sizeof(cases) / sizeof(cases[0]);
+
+	char const *directory = "golden";
+	bool update = false;
+	int c;
+	while ((c = getopt(argc, argv, "d:u")) != -1) {
+		if (c == 'd' && strlen(optarg) < GOLDEN_PATH_BYTES / 2) {
+			directory = optarg;
+		} else if (c == 'u') {
+			update = true;
+		} else {
+			usage();
+		}
+	}
+
+	bool ok = true;
+	for (int i = 0; i < reference_view_count; ++i) {
+		ReferenceView const *ref = &reference_views[i];
+		bool selected = optind == argc;
+		for (int j = optind; j < argc; ++j) {
+			selected |= strcmp(argv[j], ref->name) == 0;
+		}
+		if (selected && update) {
+			ok &= update_golden(directory, ref);
+		}
+	}
+	if (update) {
+		return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
+	for (int i = 0; i < case_count; ++i) {
+		// The GPU may be missing on machines that have no EGL.
+		Backend *b = backend_create(cases[i].backend);
+		if (b == NULL) {
+			printf("%-10s %-6s skipped, backend unavailable\n",
+			    cases[i].backend, render_mode_name(cases[i].mode));
+			continue;
+		}
+		for (int j = 0; j < reference_view_count; ++j) {
+			ReferenceView const *ref = &reference_views[j];
+			bool selected = optind == argc;
+			for (int k = optind; k < argc; ++k) {
+				selected |= strcmp(argv[k], ref->name) == 0;
+			}
+			if (!selected) {
+				continue;
+			}
+			Canvas golden;
+			if (!read_golden(directory, ref, &golden)) {
+				ok = false;
+				continue;
+			}
+			ok &= run_case(b, &cases[i], ref, &golden);
+			canvas_free(&golden);
+		}
+		backend_destroy(b);
+	}
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static bool
+update_golden(char const *directory, ReferenceView const *ref)
+{
+	char path[GOLDEN_PATH_BYTES];
+	golden_path(path, directory, ref->name);
+
+	View view;
+	Canvas c;
+	fit_view(&ref->view, GOLDEN_WIDTH, GOLDEN_HEIGHT, &view);
+	size_t n = (size_t)GOLDEN_WIDTH * GOLDEN_HEIGHT;
+	uint8_t *encoded = malloc(CODEC_BOUND(n));
+	if (encoded == NULL || !canvas_init(&c, &view, ref->iterations,
+	    GOLDEN_WIDTH, GOLDEN_HEIGHT)) {
+		exit(EXIT_FAILURE);
+	}
+	Rect all = {0, 0, GOLDEN_WIDTH, GOLDEN_HEIGHT};
+	render(&c, &all, RENDER_MODE_BRUTE, NULL);
+
+	Header h;
+	memset(&h, 0, sizeof(Header));
+	memcpy(h.magic, GOLDEN_MAGIC, sizeof(h.magic));
+	h.formula = RENDER_FORMULA;
+	h.iterations = ref->iterations;
+	h.width = GOLDEN_WIDTH;
+	h.height = GOLDEN_HEIGHT;
+	h.length = codec_encode(c.counts, GOLDEN_WIDTH, GOLDEN_HEIGHT,
+	    encoded);
+	h.view[0] = view.x;
+	h.view[1] = view.y;
+	h.view[2] = view.width;
+	h.view[3] = view.height;
+
+	FILE *f = fopen(path, "wb");
+	bool ok = f != NULL && fwrite(&h, sizeof(Header), 1, f) == 1 &&
+	    fwrite(encoded, 1, h.length, f) == h.length;
+	if (f != NULL) {
+		ok &= fclose(f) == 0;
+	}
+	if (ok) {
+		printf("%-10s written to %s\n", ref->name, path);
+	} else {
+		fprintf(stderr, "%s: cannot write golden file\n", path);
+	}
+	free(encoded);
+	canvas_free(&c);
+	return ok;
+}
+
+// Returns false if the file is missing or damaged, or if it was made for
+// another view, size or iteration formula.
+static bool
+read_golden(char const *directory, ReferenceView const *ref, Canvas *c)
+{
+	char path[GOLDEN_PATH_BYTES];
+	golden_path(path, directory, ref->name);
+
+	View view;
+	fit_view(&ref->view, GOLDEN_WIDTH, GOLDEN_HEIGHT, &view);
+	size_t n = (size_t)GOLDEN_WIDTH * GOLDEN_HEIGHT;
+	uint8_t *encoded = malloc(CODEC_BOUND(n));
+	if (encoded == NULL || !canvas_init(c, &view, ref->iterations,
+	    GOLDEN_WIDTH, GOLDEN_HEIGHT)) {
+		exit(EXIT_FAILURE);
+	}
+
+	Header h;
+	FILE *f = fopen(path, "rb");
+	bool ok = f != NULL && fread(&h, sizeof(Header), 1, f) == 1 &&
+	    memcmp(h.magic, GOLDEN_MAGIC, sizeof(h.magic)) == 0 &&
+	    h.formula == RENDER_FORMULA &&
+	    h.iterations == (uint32_t)ref->iterations &&
+	    h.width == GOLDEN_WIDTH && h.height == GOLDEN_HEIGHT &&
+	    h.length <= CODEC_BOUND(n) && h.view[0] == view.x &&
+	    h.view[1] == view.y && h.view[2] == view.width &&
+	    h.view[3] == view.height &&
+	    fread(encoded, 1, h.length, f) == h.length &&
+	    codec_decode(encoded, h.length, GOLDEN_WIDTH, GOLDEN_HEIGHT,
+	    c->counts);
+	if (f != NULL) {
+		fclose(f);
+	}
+	free(encoded);
+	if (!ok) {
+		fprintf(stderr, "%s: missing, damaged or out of date golden "
+		    "file, run mandelbrot test -u\n", path);
+		canvas_free(c);
+	}
+	return ok;
+}
+
+static bool
+run_case(Backend *b, Case const *t, ReferenceView const *ref,
+    Canvas const *golden)
+{
+	char const *mode = render_mode_name(t->mode);
+	if (strcmp(backend_name(b), "gpu") == 0 &&
+	    !resolvable(&golden->view, golden->height)) {
+		printf("%-10s %-6s %-10s skipped, beyond single precision\n",
+		    t->backend, mode, ref->name);
+		return true;
+	}
+
+	Canvas c;
+	if (!canvas_init(&c, &golden->view, golden->iterations, golden->width,
+	    golden->height)) {
+		exit(EXIT_FAILURE);
+	}
+	if (!backend_render(b, &c, t->mode)) {
+		printf("%-10s %-6s %-10s FAIL render failed\n", t->backend,
+		    mode, ref->name);
+		canvas_free(&c);
+		return false;
+	}
+
+	size_t n = (size_t)c.width * c.height, differing = 0, failing = 0;
+	for (int y = 0; y < c.height; ++y) {
+		for (int x = 0; x < c.width; ++x) {
+			size_t i = (size_t)y * c.width + x;
+			differing += c.counts[i] != golden->counts[i];
+			failing += !matches(&c, golden, x, y);
+		}
+	}
+	bool ok;
+	if (t->tolerance == 0.) {
+		ok = differing == 0;
+		printf("%-10s %-6s %-10s %s %zu of %zu pixels differ, none "
+		    "allowed\n", t->backend, mode, ref->name,
+		    ok ? "ok  " : "FAIL", differing, n);
+	} else {
+		ok = failing <= t->tolerance * n;
+		printf("%-10s %-6s %-10s %s %zu of %zu pixels differ, %zu "
+		    "(%.3f%%) beyond a neighbor, %.3f%% allowed\n",
+		    t->backend, mode, ref->name, ok ? "ok  " : "FAIL",
+		    differing, n, failing, 100. * failing / n,
+		    100. * t->tolerance);
+	}
+	canvas_free(&c);
+	return ok;
+}
+
+static bool
+matches(Canvas const *c, Canvas const *golden, int x, int y)
+{
+	uint32_t count = c->counts[(size_t)y * c->width + x];
+	for (int j = SDL_max(y - 1, 0); j <= SDL_min(y + 1, c->height - 1);
+	    ++j) {
+		for (int i = SDL_max(x - 1, 0); i <= SDL_min(x + 1,
+		    c->width - 1); ++i) {
+			if (golden->counts[(size_t)j * c->width + i] ==
+			    count) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+// Returns true if neighboring pixels of a view are far enough apart to be
+// told apart in single precision.
+static bool
+resolvable(View const *v, int height)
+{
+	double spacing = 2. * v->height / height;
+	double extent = fmax(fabs(v->x), fabs(v->y)) + v->width;
+	return spacing > 16. * FLT_EPSILON * extent;
+}
+
+static void
+golden_path(char *path, char const *directory, char const *name)
+{
+	snprintf(path, GOLDEN_PATH_BYTES, "%s/%s.mbg", directory, name);
+}
+
+static void
+usage(void)
+{
+	fprintf(stderr, "usage: mandelbrot test [-d directory] [-u] "
+	    "[view...]\n");
+	exit(EXIT_FAILURE);
+}
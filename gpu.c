@@ -0,0 +1,244 @@
+// Copyright (c) 2025 Charles Hood <chood@chood.net>
+//
+// This program is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+
+#include <stdlib.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GLES3/gl3.h>
+#include "gpu.h"
+#include "shader.h"
+
+#define GPU_TILE_SIZE 1024
+
+// Renders escape counts into an integer texture with an EGL context that has
+// no window, so that it works without a display server.
+struct Gpu {
+	EGLDisplay display;
+	EGLContext context;
+	EGLSurface surface;
+	GLuint program;
+	GLint transformation_uniform;
+	GLint iterations_uniform;
+	GLuint vertex_array;
+	GLuint texture;
+	GLuint framebuffer;
+	GLuint *pixels;
+};
+
+static bool create_context(Gpu *);
+
+static char const count_frag_shader_source[] = "\
+#version 300 es\n\
+precision highp float;\n\
+precision highp int;\n\
+\n\
+uniform int iterations;\n\
+\n\
+in vec2 frag_position;\n\
+\n\
+out uint out_count;\n\
+\n\
+void\n\
+main()\n\
+{\n\
+	vec2 p = frag_position;\n\
+\n\
+	vec2 z = vec2(0.);\n\
+	int i;\n\
+	for (i = 0; i < iterations && dot(z, z) <= 4.; ++i) {\n\
+		z = vec2(z.x * z.x - z.y * z.y + p.x, 2. * z.x * z.y + p.y);\n\
+	}\n\
+	out_count = uint(i);\n\
+}\n\
+";
+
+// The context is current on the calling thread, which is the only one that
+// may use the returned object.
+Gpu *
+gpu_create(void)
+{
+	Gpu *g = calloc(1, sizeof(Gpu));
+	if (g == NULL) {
+		return NULL;
+	}
+	g->display = EGL_NO_DISPLAY;
+	g->context = EGL_NO_CONTEXT;
+	g->surface = EGL_NO_SURFACE;
+	g->pixels = malloc(GPU_TILE_SIZE * GPU_TILE_SIZE * 4 *
+	    sizeof(GLuint));
+	if (g->pixels == NULL || !create_context(g)) {
+		gpu_destroy(g);
+		return NULL;
+	}
+
+	g->program = create_program(vert_shader_source,
+	    count_frag_shader_source);
+	if (g->program == 0) {
+		gpu_destroy(g);
+		return NULL;
+	}
+	g->transformation_uniform =
+	    glGetUniformLocation(g->program, "transformation");
+	g->iterations_uniform = glGetUniformLocation(g->program, "iterations");
+
+	glGenVertexArrays(1, &g->vertex_array);
+	glGenTextures(1, &g->texture);
+	glBindTexture(GL_TEXTURE_2D, g->texture);
+	glTexStorage2D(GL_TEXTURE_2D, 1, GL_R32UI, GPU_TILE_SIZE,
+	    GPU_TILE_SIZE);
+	glGenFramebuffers(1, &g->framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, g->framebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+	    GL_TEXTURE_2D, g->texture, 0);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) !=
+	    GL_FRAMEBUFFER_COMPLETE) {
+		gpu_destroy(g);
+		return NULL;
+	}
+	return g;
+}
+
+void
+gpu_destroy(Gpu *g)
+{
+	if (g->context != EGL_NO_CONTEXT) {
+		glDeleteFramebuffers(1, &g->framebuffer);
+		glDeleteTextures(1, &g->texture);
+		glDeleteVertexArrays(1, &g->vertex_array);
+		glDeleteProgram(g->program);
+		eglMakeCurrent(g->display, EGL_NO_SURFACE, EGL_NO_SURFACE,
+		    EGL_NO_CONTEXT);
+		eglDestroyContext(g->display, g->context);
+	}
+	if (g->surface != EGL_NO_SURFACE) {
+		eglDestroySurface(g->display, g->surface);
+	}
+	if (g->display != EGL_NO_DISPLAY) {
+		eglTerminate(g->display);
+	}
+	free(g->pixels);
+	free(g);
+}
+
+// Renders the canvas in tiles, each drawn with the part of the view that it
+// covers. Only the brute-force method is available on the GPU.
+bool
+gpu_render(Gpu *g, Canvas *c)
+{
+	glUseProgram(g->program);
+	glBindVertexArray(g->vertex_array);
+	glBindFramebuffer(GL_FRAMEBUFFER, g->framebuffer);
+	glUniform1i(g->iterations_uniform, c->iterations);
+
+	for (int y = 0; y < c->height; y += GPU_TILE_SIZE) {
+		for (int x = 0; x < c->width; x += GPU_TILE_SIZE) {
+			int w = c->width - x < GPU_TILE_SIZE ?
+			    c->width - x : GPU_TILE_SIZE;
+			int h = c->height - y < GPU_TILE_SIZE ?
+			    c->height - y : GPU_TILE_SIZE;
+
+			View v;
+			v.x = c->view.x + c->view.width *
+			    (2. * (x + .5 * w) / c->width - 1.);
+			v.y = c->view.y + c->view.height *
+			    (1. - 2. * (y + .5 * h) / c->height);
+			v.width = c->view.width * w / c->width;
+			v.height = c->view.height * h / c->height;
+
+			glViewport(0, 0, w, h);
+			glUniform4f(g->transformation_uniform, v.x, v.y,
+			    v.width, v.height);
+			glDrawArrays(GL_TRIANGLES, 0, 6);
+			glReadPixels(0, 0, w, h, GL_RGBA_INTEGER,
+			    GL_UNSIGNED_INT, g->pixels);
+
+			for (int j = 0; j < h; ++j) {
+				uint32_t *row = c->counts +
+				    (size_t)(y + h - 1 - j) * c->width + x;
+				for (int i = 0; i < w; ++i) {
+					row[i] = g->pixels[4 * (j * w + i)];
+				}
+			}
+		}
+	}
+	return glGetError() == GL_NO_ERROR;
+}
+
+// Prefers a surfaceless display and falls back to the default display with a
+// small pixel buffer surface.
+static bool
+create_context(Gpu *g)
+{
+	bool surfaceless = false;
+#ifdef EGL_PLATFORM_SURFACELESS_MESA
+	PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display =
+	    (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress(
+	    "eglGetPlatformDisplayEXT");
+	if (get_platform_display != NULL) {
+		g->display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA,
+		    EGL_DEFAULT_DISPLAY, NULL);
+		surfaceless = g->display != EGL_NO_DISPLAY &&
+		    eglInitialize(g->display, NULL, NULL);
+	}
+#endif
+	if (!surfaceless) {
+		g->display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+		if (g->display == EGL_NO_DISPLAY ||
+		    !eglInitialize(g->display, NULL, NULL)) {
+			g->display = EGL_NO_DISPLAY;
+			return false;
+		}
+	}
+	if (!eglBindAPI(EGL_OPENGL_ES_API)) {
+		return false;
+	}
+
+	EGLint config_attributes[] = {
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_ES3_BIT,
+		EGL_SURFACE_TYPE, surfaceless ? 0 : EGL_PBUFFER_BIT,
+		EGL_NONE,
+	};
+	EGLConfig config;
+	EGLint config_count;
+	if (!eglChooseConfig(g->display, config_attributes, &config, 1,
+	    &config_count) || config_count == 0) {
+		return false;
+	}
+
+	EGLint context_attributes[] = {
+		EGL_CONTEXT_MAJOR_VERSION, 3,
+		EGL_CONTEXT_MINOR_VERSION, 0,
+		EGL_NONE,
+	};
+	g->context = eglCreateContext(g->display, config, EGL_NO_CONTEXT,
+	    context_attributes);
+	if (g->context == EGL_NO_CONTEXT) {
+		return false;
+	}
+
+	if (!surfaceless) {
+		EGLint surface_attributes[] = {
+			EGL_WIDTH, 1,
+			EGL_HEIGHT, 1,
+			EGL_NONE,
+		};
+		g->surface = eglCreatePbufferSurface(g->display, config,
+		    surface_attributes);
+		if (g->surface == EGL_NO_SURFACE) {
+			return false;
+		}
+	}
+	return eglMakeCurrent(g->display, g->surface, g->surface, g->context);
+}
@@ -0,0 +1,220 @@
+// Copyright (c) 2025 Charles Hood <chood@chood.net>
+//
+// This program is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "backend.h"
+#include "headless.h"
+#include "image.h"
+#include "iterfile.h"
+
+static void usage(void);
+
+// Parses a point written as "x,y".
+bool
+parse_point(char const *s, double *p)
+{
+	char *end;
+	p[0] = strtod(s, &end);
+	if (end == s || *end != ',') {
+		return false;
+	}
+	s = end + 1;
+	p[1] = strtod(s, &end);
+	return end != s && *end == '\0';
+}
+
+// Parses a square focus written as "x,y,scale", where scale is its
+// half-height.
+bool
+parse_focus(char const *s, View *v)
+{
+	double p[3];
+	char *end;
+	for (int i = 0; i < 3; ++i) {
+		p[i] = strtod(s, &end);
+		if (end == s || *end != (i < 2 ? ',' : '\0')) {
+			return false;
+		}
+		s = end + 1;
+	}
+	v->x = p[0];
+	v->y = p[1];
+	v->width = v->height = p[2];
+	return p[2] > 0.;
+}
+
+// Parses a size written as "WIDTHxHEIGHT".
+bool
+parse_size(char const *s, int *width, int *height)
+{
+	char *end;
+	long w = strtol(s, &end, 10);
+	if (end == s || *end != 'x') {
+		return false;
+	}
+	s = end + 1;
+	long h = strtol(s, &end, 10);
+	if (end == s || *end != '\0' || w <= 0 || h <= 0 || w > 1 << 20 ||
+	    h > 1 << 20) {
+		return false;
+	}
+	*width = w;
+	*height = h;
+	return true;
+}
+
+void
+render_options_init(RenderOptions *o)
+{
+	o->focus.x = -.5;
+	o->focus.y = 0.;
+	o->focus.width = 1.25;
+	o->focus.height = 1.25;
+	o->width = 1280;
+	o->height = 800;
+	o->iterations = 256;
+	o->mode = RENDER_MODE_BRUTE;
+	o->backend = "cpu";
+	o->path = NULL;
+}
+
+// Handles one of the options in RENDER_OPTIONS. Returns false if the option
+// is unknown or its argument is invalid.
+bool
+render_options_parse(RenderOptions *o, int option, char const *arg)
+{
+	double p[2];
+	char *end;
+	long iterations;
+	switch (option) {
+	case 'b':
+		o->backend = arg;
+		return true;
+	case 'c':
+		if (!parse_point(arg, p)) {
+			return false;
+		}
+		o->focus.x = p[0];
+		o->focus.y = p[1];
+		return true;
+	case 'g':
+		return parse_size(arg, &o->width, &o->height);
+	case 'i':
+		iterations = strtol(arg, &end, 10);
+		if (end == arg || *end != '\0' || iterations <= 0 ||
+		    iterations > INT_MAX) {
+			return false;
+		}
+		o->iterations = iterations;
+		return true;
+	case 'm':
+		return render_mode_parse(arg, &o->mode);
+	case 'o':
+		o->path = arg;
+		return true;
+	case 's':
+		o->focus.width = o->focus.height = strtod(arg, &end);
+		return end != arg && *end == '\0' && o->focus.height > 0.;
+	}
+	return false;
+}
+
+void
+render_options_view(RenderOptions const *o, View *v)
+{
+	fit_view(&o->focus, o->width, o->height, v);
+}
+
+// Renders a single image without opening a window, so that it also works
+// where there is no display server.
+int
+render_main(int argc, char **argv)
+{
+	RenderOptions o;
+	render_options_init(&o);
+	int c;
+	while ((c = getopt(argc, argv, RENDER_OPTIONS)) != -1) {
+		if (!render_options_parse(&o, c, optarg)) {
+			usage();
+		}
+	}
+	if (o.path == NULL || optind != argc) {
+		usage();
+	}
+
+	// Iteration files are sampled by brute force on the CPU.
+	size_t length = strlen(o.path);
+	if (length > 4 && strcmp(o.path + length - 4, ".mbi") == 0) {
+		View view;
+		render_options_view(&o, &view);
+		if (!iterfile_render(o.path, &view, o.iterations, o.width,
+		    o.height)) {
+			fprintf(stderr, "%s: cannot write iteration file\n",
+			    o.path);
+			return EXIT_FAILURE;
+		}
+		return EXIT_SUCCESS;
+	}
+
+	Backend *b = backend_create(o.backend);
+	if (b == NULL) {
+		fprintf(stderr, "%s: backend is unknown or unavailable\n",
+		    o.backend);
+		return EXIT_FAILURE;
+	}
+
+	View view;
+	render_options_view(&o, &view);
+	Canvas canvas;
+	uint8_t *pixels = malloc((size_t)o.width * o.height * 4);
+	if (pixels == NULL || !canvas_init(&canvas, &view, o.iterations,
+	    o.width, o.height)) {
+		exit(EXIT_FAILURE);
+	}
+	if (!backend_render(b, &canvas, o.mode)) {
+		fprintf(stderr, "%s: render failed\n", backend_name(b));
+		return EXIT_FAILURE;
+	}
+	backend_destroy(b);
+
+	Rect all = {0, 0, o.width, o.height};
+	colorize(&canvas, &all, pixels);
+	canvas_free(&canvas);
+
+	ImageWriter *w = image_create(o.path, o.width, o.height);
+	if (w == NULL || !image_write(w, pixels, o.height) ||
+	    !image_close(w)) {
+		fprintf(stderr, "%s: cannot write image\n", o.path);
+		return EXIT_FAILURE;
+	}
+	free(pixels);
+	return EXIT_SUCCESS;
+}
+
+static void
+usage(void)
+{
+	fprintf(stderr, "usage: mandelbrot render [-b cpu|gpu] [-c x,y] "
+	    "[-s scale] [-g WIDTHxHEIGHT]\n"
+	    "                         [-i iterations] "
+	    "[-m brute|trace|guess] -o file\n");
+	exit(EXIT_FAILURE);
+}
@@ -0,0 +1,43 @@
+// Copyright (c) 2025 Charles Hood <chood@chood.net>
+//
+// This program is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#include <stdbool.h>
+#include "render.h"
+
+// Options shared by the commands that render without a window.
+typedef struct {
+	View focus;
+	int width;
+	int height;
+	int iterations;
+	RenderMode mode;
+	char const *backend;
+	char const *path;
+} RenderOptions;
+
+#define RENDER_OPTIONS "b:c:g:i:m:o:s:"
+
+bool parse_point(char const *, double *);
+bool parse_focus(char const *, View *);
+bool parse_size(char const *, int *, int *);
+void render_options_init(RenderOptions *);
+bool render_options_parse(RenderOptions *, int, char const *);
+void render_options_view(RenderOptions const *, View *);
+int render_main(int, char **);
+
+#endif
@@ -0,0 +1,391 @@
+// Copyright (c) 2025 Charles Hood <chood@chood.net>
+//
+// This program is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <GLES3/gl3.h>
+#include <GLES2/gl2ext.h>
+#include "hud.h"
+#include "shader.h"
+
+#define HUD_WIDTH 128
+#define HUD_HEIGHT 98
+#define HUD_SCALE 2
+#define HUD_MARGIN 8
+#define HUD_LINE 9
+#define HUD_GRAPH_TOP 64
+#define HUD_GRAPH_HEIGHT 32
+#define HUD_HISTORY 120
+#define HUD_QUERIES 4
+#define HUD_FENCE_TIMEOUT 1000000000
+
+#define GLYPH_WIDTH 5
+#define GLYPH_HEIGHT 7
+
+typedef struct {
+	Uint64 events;
+	Uint64 draw;
+	Uint64 swap;
+	Uint64 gpu;
+} Sample;
+
+// Shows how long the last frames took: CPU time spent handling events,
+// drawing and swapping, and GPU time spent drawing the set. The GPU time
+// comes from timer queries where GL_EXT_disjoint_timer_query is available,
+// read a few frames later so that they never stall. Otherwise it is the time
+// until a fence after the draw signals, which waits for the GPU while the
+// HUD is shown. It also shows the iterations that the current frame cost,
+// in heatmap mode.
+struct Hud {
+	GLuint program;
+	GLint transformation_uniform;
+	GLint image_uniform;
+	GLuint texture;
+	uint8_t pixels[HUD_HEIGHT][HUD_WIDTH][4];
+
+	bool timer;
+	PFNGLGETQUERYOBJECTUI64VEXTPROC get_query_result;
+	GLuint queries[HUD_QUERIES];
+	int query_frames[HUD_QUERIES];
+	int query_head;
+	int query_count;
+	bool measuring;
+	Uint64 draw_start;
+	Uint64 fence_time;
+
+	Sample history[HUD_HISTORY];
+	int frame;
+
+	Uint64 cost;
+	Uint64 cost_pixels;
+};
+
+static void collect_queries(Hud *);
+static void fill(Hud *, int, int, int, int, uint32_t);
+static void print(Hud *, int, int, char const *);
+static void paint(Hud *);
+
+static char const hud_frag_shader_source[] = "\
+#version 300 es\n\
+precision mediump float;\n\
+\n\
+uniform sampler2D image;\n\
+\n\
+in vec2 frag_position;\n\
+\n\
+out vec4 out_color;\n\
+\n\
+void\n\
+main()\n\
+{\n\
+	out_color = texture(image, vec2(frag_position.x,\n\
+	    1. - frag_position.y));\n\
+}\n\
+";
+
+// Rows of 5x7 glyphs for the characters that the HUD prints, from the top,
+// with the leftmost pixel in bit 4.
+static char const glyph_chars[] = "0123456789.-ACDEFGIMNPRSTUVW";
+static uint8_t const glyphs[][GLYPH_HEIGHT] = {
+	{0x0e, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0e},
+	{0x04, 0x0c, 0x04, 0x04, 0x04, 0x04, 0x0e},
+	{0x0e, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1f},
+	{0x1f, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0e},
+	{0x02, 0x06, 0x0a, 0x12, 0x1f, 0x02, 0x02},
+	{0x1f, 0x10, 0x1e, 0x01, 0x01, 0x11, 0x0e},
+	{0x06, 0x08, 0x10, 0x1e, 0x11, 0x11, 0x0e},
+	{0x1f, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08},
+	{0x0e, 0x11, 0x11, 0x0e, 0x11, 0x11, 0x0e},
+	{0x0e, 0x11, 0x11, 0x0f, 0x01, 0x02, 0x0c},
+	{0x00, 0x00, 0x00, 0x00, 0x00, 0x0c, 0x0c},
+	{0x00, 0x00, 0x00, 0x0e, 0x00, 0x00, 0x00},
+	{0x0e, 0x11, 0x11, 0x1f, 0x11, 0x11, 0x11},
+	{0x0e, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0e},
+	{0x1e, 0x11, 0x11, 0x11, 0x11, 0x11, 0x1e},
+	{0x1f, 0x10, 0x10, 0x1e, 0x10, 0x10, 0x1f},
+	{0x1f, 0x10, 0x10, 0x1e, 0x10, 0x10, 0x10},
+	{0x0e, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0f},
+	{0x0e, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0e},
+	{0x11, 0x1b, 0x15, 0x15, 0x11, 0x11, 0x11},
+	{0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11},
+	{0x1e, 0x11, 0x11, 0x1e, 0x10, 0x10, 0x10},
+	{0x1e, 0x11, 0x11, 0x1e, 0x14, 0x12, 0x11},
+	{0x0f, 0x10, 0x10, 0x0e, 0x01, 0x01, 0x1e},
+	{0x1f, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04},
+	{0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0e},
+	{0x11, 0x11, 0x11, 0x11, 0x11, 0x0a, 0x04},
+	{0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0a},
+};
+
+// The window's context must be current.
+Hud *
+hud_create(void)
+{
+	Hud *h = calloc(1, sizeof(Hud));
+	if (h == NULL) {
+		return NULL;
+	}
+	h->program = create_program(vert_shader_source,
+	    hud_frag_shader_source);
+	if (h->program == 0) {
+		free(h);
+		return NULL;
+	}
+	h->transformation_uniform = glGetUniformLocation(h->program,
+	    "transformation");
+	h->image_uniform = glGetUniformLocation(h->program, "image");
+
+	glGenTextures(1, &h->texture);
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D, h->texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, HUD_WIDTH, HUD_HEIGHT, 0,
+	    GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	glActiveTexture(GL_TEXTURE0);
+
+	if (SDL_GL_ExtensionSupported("GL_EXT_disjoint_timer_query")) {
+		h->get_query_result = (PFNGLGETQUERYOBJECTUI64VEXTPROC)
+		    SDL_GL_GetProcAddress("glGetQueryObjectui64vEXT");
+	}
+	h->timer = h->get_query_result != NULL;
+	if (h->timer) {
+		glGenQueries(HUD_QUERIES, h->queries);
+	}
+	return h;
+}
+
+void
+hud_destroy(Hud *h)
+{
+	if (h->timer) {
+		glDeleteQueries(HUD_QUERIES, h->queries);
+	}
+	glDeleteTextures(1, &h->texture);
+	glDeleteProgram(h->program);
+	free(h);
+}
+
+// Brackets the draw whose GPU time is shown.
+void
+hud_begin_draw(Hud *h)
+{
+	if (!h->timer) {
+		h->draw_start = SDL_GetTicksNS();
+		return;
+	}
+	collect_queries(h);
+	h->measuring = h->query_count < HUD_QUERIES;
+	if (h->measuring) {
+		glBeginQuery(GL_TIME_ELAPSED_EXT, h->queries[h->query_head]);
+	}
+}
+
+void
+hud_end_draw(Hud *h)
+{
+	if (!h->timer) {
+		GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+		    HUD_FENCE_TIMEOUT);
+		glDeleteSync(fence);
+		h->fence_time = SDL_GetTicksNS() - h->draw_start;
+		return;
+	}
+	if (h->measuring) {
+		glEndQuery(GL_TIME_ELAPSED_EXT);
+		h->query_frames[h->query_head] = h->frame;
+		h->query_head = (h->query_head + 1) % HUD_QUERIES;
+		++h->query_count;
+	}
+}
+
+// Adds the CPU times of a frame, in nanoseconds.
+void
+hud_record(Hud *h, Uint64 events, Uint64 draw, Uint64 swap)
+{
+	Sample *s = &h->history[h->frame % HUD_HISTORY];
+	s->events = events;
+	s->draw = draw;
+	s->swap = swap;
+	s->gpu = h->timer ? 0 : h->fence_time;
+	++h->frame;
+}
+
+// Sets the iterations computed for the frame that is shown and the number of
+// pixels that they were computed for, which is zero if its cost is unknown.
+void
+hud_set_cost(Hud *h, Uint64 cost, Uint64 pixels)
+{
+	h->cost = cost;
+	h->cost_pixels = pixels;
+}
+
+// Draws the HUD in the top left corner of a window of the given size.
+void
+hud_draw(Hud *h, int width, int height)
+{
+	if (h->timer) {
+		collect_queries(h);
+	}
+	paint(h);
+
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D, h->texture);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, HUD_WIDTH, HUD_HEIGHT,
+	    GL_RGBA, GL_UNSIGNED_BYTE, h->pixels);
+	glActiveTexture(GL_TEXTURE0);
+
+	glViewport(HUD_MARGIN, height - HUD_MARGIN - HUD_HEIGHT * HUD_SCALE,
+	    HUD_WIDTH * HUD_SCALE, HUD_HEIGHT * HUD_SCALE);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glUseProgram(h->program);
+	glUniform4f(h->transformation_uniform, .5f, .5f, .5f, .5f);
+	glUniform1i(h->image_uniform, 1);
+	glDrawArrays(GL_TRIANGLES, 0, 6);
+	glDisable(GL_BLEND);
+	glViewport(0, 0, width, height);
+}
+
+// Takes the results of finished timer queries, oldest first. Results from a
+// disjoint period, such as a GPU frequency change, are dropped.
+static void
+collect_queries(Hud *h)
+{
+	GLint disjoint = 0;
+	glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+	while (h->query_count > 0) {
+		int i = (h->query_head - h->query_count + HUD_QUERIES) %
+		    HUD_QUERIES;
+		GLuint available = GL_FALSE;
+		glGetQueryObjectuiv(h->queries[i], GL_QUERY_RESULT_AVAILABLE,
+		    &available);
+		if (!available) {
+			break;
+		}
+		GLuint64 elapsed = 0;
+		h->get_query_result(h->queries[i], GL_QUERY_RESULT, &elapsed);
+		int frame = h->query_frames[i];
+		if (!disjoint && h->frame - frame <= HUD_HISTORY) {
+			h->history[frame % HUD_HISTORY].gpu = elapsed;
+		}
+		--h->query_count;
+	}
+}
+
+static void
+fill(Hud *h, int x, int y, int width, int height, uint32_t rgba)
+{
+	for (int j = y; j < y + height; ++j) {
+		for (int i = x; i < x + width; ++i) {
+			h->pixels[j][i][0] = rgba >> 24;
+			h->pixels[j][i][1] = rgba >> 16;
+			h->pixels[j][i][2] = rgba >> 8;
+			h->pixels[j][i][3] = rgba;
+		}
+	}
+}
+
+static void
+print(Hud *h, int x, int y, char const *text)
+{
+	for (; *text != '\0' && x + GLYPH_WIDTH <= HUD_WIDTH; ++text) {
+		char const *c = strchr(glyph_chars, *text);
+		if (c != NULL && *text != '\0') {
+			uint8_t const *g = glyphs[c - glyph_chars];
+			for (int j = 0; j < GLYPH_HEIGHT; ++j) {
+				for (int i = 0; i < GLYPH_WIDTH; ++i) {
+					if (g[j] >> (GLYPH_WIDTH - 1 - i) & 1) {
+						fill(h, x + i, y + j, 1, 1,
+						    0xffffffff);
+					}
+				}
+			}
+		}
+		x += GLYPH_WIDTH + 1;
+	}
+}
+
+// Draws the times of the last frame, the newest GPU time that is known, as
+// timer queries are only collected a few frames later, the cost of the frame
+// that is shown, and a graph of the frames before it, a bar for each with its
+// events, draw and swap times stacked from the bottom in yellow, green and
+// blue, the GPU time as a red mark, and a line at 16 ms. The graph shows 1 ms
+// per pixel.
+static void
+paint(Hud *h)
+{
+	fill(h, 0, 0, HUD_WIDTH, HUD_HEIGHT, 0x000000b0);
+	Sample const *last = &h->history[(h->frame + HUD_HISTORY - 1) %
+	    HUD_HISTORY];
+	Uint64 gpu = 0;
+	for (int i = 1; i <= SDL_min(h->frame, HUD_HISTORY) && gpu == 0;
+	    ++i) {
+		gpu = h->history[(h->frame - i) % HUD_HISTORY].gpu;
+	}
+	char const *labels[] = {"EVENTS", "DRAW", "SWAP", "FRAME",
+	    h->timer ? "GPU TIMER" : "GPU FENCE"};
+	Uint64 times[] = {last->events, last->draw, last->swap,
+	    last->events + last->draw + last->swap, gpu};
+	for (int i = 0; i < 5; ++i) {
+		char line[32];
+		snprintf(line, sizeof(line), "%-9s %7.2f MS", labels[i],
+		    times[i] / 1e6);
+		if (i == 4 && gpu == 0) {
+			snprintf(line, sizeof(line), "%-9s       - MS",
+			    labels[i]);
+		}
+		print(h, 2, 2 + i * HUD_LINE, line);
+	}
+	char line[32];
+	if (h->cost_pixels == 0) {
+		snprintf(line, sizeof(line), "%-9s       -", "ITERS");
+		print(h, 2, 2 + 5 * HUD_LINE, line);
+		snprintf(line, sizeof(line), "%-9s       -", "MEAN");
+		print(h, 2, 2 + 6 * HUD_LINE, line);
+	} else {
+		snprintf(line, sizeof(line), "%-9s %7.1f M", "ITERS",
+		    h->cost / 1e6);
+		print(h, 2, 2 + 5 * HUD_LINE, line);
+		snprintf(line, sizeof(line), "%-9s %7.1f", "MEAN",
+		    (double)h->cost / h->cost_pixels);
+		print(h, 2, 2 + 6 * HUD_LINE, line);
+	}
+
+	int bottom = HUD_GRAPH_TOP + HUD_GRAPH_HEIGHT;
+	fill(h, 0, bottom - 16, HUD_WIDTH, 1, 0x808080ff);
+	int count = h->frame < HUD_HISTORY ? h->frame : HUD_HISTORY;
+	for (int i = 0; i < count; ++i) {
+		Sample const *s = &h->history[(h->frame - count + i) %
+		    HUD_HISTORY];
+		int x = HUD_WIDTH - count + i - 4;
+		Uint64 parts[] = {s->events, s->draw, s->swap};
+		uint32_t colors[] = {0xffd000ff, 0x40e040ff, 0x4080ffff};
+		int y = bottom;
+		for (int j = 0; j < 3 && y > HUD_GRAPH_TOP; ++j) {
+			int height = (int)(parts[j] / 1000000);
+			height = SDL_min(height, y - HUD_GRAPH_TOP);
+			fill(h, x, y - height, 1, height, colors[j]);
+			y -= height;
+		}
+		int gpu = (int)SDL_min(s->gpu / 1000000,
+		    (Uint64)HUD_GRAPH_HEIGHT - 1);
+		if (s->gpu != 0) {
+			fill(h, x, bottom - 1 - gpu, 1, 1, 0xff4040ff);
+		}
+	}
+}
@@ -0,0 +1,31 @@
+// Copyright (c) 2025 Charles Hood <chood@chood.net>
+//
+// This program is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef HUD_H
+#define HUD_H
+
+#include <SDL3/SDL.h>
+
+typedef struct Hud Hud;
+
+Hud *hud_create(void);
+void hud_destroy(Hud *);
+void hud_begin_draw(Hud *);
+void hud_end_draw(Hud *);
+void hud_record(Hud *, Uint64, Uint64, Uint64);
+void hud_set_cost(Hud *, Uint64, Uint64);
+void hud_draw(Hud *, int, int);
+
+#endif
@@ -0,0 +1,222 @@
+// Copyright (c) 2025 Charles Hood <chood@chood.net>
+//
+// This program is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+
+#include <setjmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <png.h>
+#include "image.h"
+
+// Writes an RGB image a few rows at a time, so that it never has to be held
+// in memory as a whole. The alpha channel of the rows is dropped.
+struct ImageWriter {
+	FILE *file;
+	png_structp png;
+	png_infop info;
+	int width;
+	int height;
+	int rows;
+	uint8_t *row;
+};
+
+static bool start_png(ImageWriter *);
+static bool finish_png(ImageWriter *);
+static bool has_suffix(char const *, char const *);
+
+// The format is PNG if the path ends in .png and binary PPM otherwise.
+ImageWriter *
+image_create(char const *path, int width, int height)
+{
+	ImageWriter *w = calloc(1, sizeof(ImageWriter));
+	if (w == NULL) {
+		return NULL;
+	}
+	w->width = width;
+	w->height = height;
+	w->row = malloc((size_t)width * 3);
+	w->file = fopen(path, "wb");
+	if (w->row == NULL || w->file == NULL) {
+		image_close(w);
+		return NULL;
+	}
+
+	if (!has_suffix(path, ".png")) {
+		if (fprintf(w->file, "P6\n%d %d\n255\n", width, height) < 0) {
+			image_close(w);
+			return NULL;
+		}
+		return w;
+	}
+
+	w->png = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL,
+	    NULL);
+	if (w->png != NULL) {
+		w->info = png_create_info_struct(w->png);
+	}
+	if (w->info == NULL || !start_png(w)) {
+		image_close(w);
+		return NULL;
+	}
+	return w;
+}
+
+// Appends rows of RGBA pixels to the image.
+bool
+image_write(ImageWriter *w, uint8_t const *rgba, int rows)
+{
+	if (w->png != NULL && setjmp(png_jmpbuf(w->png))) {
+		return false;
+	}
+	for (int y = 0; y < rows; ++y, ++w->rows) {
+		uint8_t const *p = rgba + (size_t)y * w->width * 4;
+		for (int x = 0; x < w->width; ++x) {
+			memcpy(&w->row[3 * x], &p[4 * x], 3);
+		}
+		if (w->png != NULL) {
+			png_write_row(w->png, w->row);
+		} else if (fwrite(w->row, 3, w->width, w->file) !=
+		    (size_t)w->width) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// Finishes and closes the image. Returns false if it could not be written
+// completely.
+bool
+image_close(ImageWriter *w)
+{
+	bool ok = w->file != NULL && w->rows == w->height;
+	if (w->png != NULL) {
+		ok = ok && finish_png(w);
+		png_destroy_write_struct(&w->png, &w->info);
+	}
+	if (w->file != NULL && fclose(w->file) != 0) {
+		ok = false;
+	}
+	free(w->row);
+	free(w);
+	return ok;
+}
+
+// Reads a PNG image of the given size into RGBA pixels. Returns false if the
+// file is missing, damaged or has another size.
+bool
+image_read(char const *path, int width, int height, uint8_t *rgba)
+{
+	png_image image;
+	memset(&image, 0, sizeof(png_image));
+	image.version = PNG_IMAGE_VERSION;
+	if (!png_image_begin_read_from_file(&image, path)) {
+		return false;
+	}
+	if (image.width != (png_uint_32)width ||
+	    image.height != (png_uint_32)height) {
+		png_image_free(&image);
+		return false;
+	}
+	image.format = PNG_FORMAT_RGBA;
+	return png_image_finish_read(&image, NULL, rgba, 0, NULL);
+}
+
+// Encodes RGBA pixels as a PNG image in memory allocated with malloc().
+bool
+image_encode_png(uint8_t const *rgba, int width, int height, uint8_t **data,
+    size_t *length)
+{
+	png_image image;
+	memset(&image, 0, sizeof(png_image));
+	image.version = PNG_IMAGE_VERSION;
+	image.width = width;
+	image.height = height;
+	image.format = PNG_FORMAT_RGBA;
+	png_alloc_size_t size = 0;
+	if (!png_image_write_to_memory(&image, NULL, &size, 0, rgba, 0,
+	    NULL)) {
+		return false;
+	}
+	*data = malloc(size);
+	if (*data == NULL) {
+		return false;
+	}
+	if (!png_image_write_to_memory(&image, *data, &size, 0, rgba, 0,
+	    NULL)) {
+		free(*data);
+		return false;
+	}
+	*length = size;
+	return true;
+}
+
+// Converts RGBA pixels to planar 4:4:4 BT.601 YCbCr with studio swing, the
+// layout of a C444 Y4M frame.
+void
+rgba_to_yuv(uint8_t const *rgba, int width, int height, uint8_t *yuv)
+{
+	size_t n = (size_t)width * height;
+	for (size_t i = 0; i < n; ++i) {
+		int r = rgba[4 * i], g = rgba[4 * i + 1], b = rgba[4 * i + 2];
+		yuv[i] = (66 * r + 129 * g + 25 * b + 4224) >> 8;
+		yuv[n + i] = (-38 * r - 74 * g + 112 * b + 32896) >> 8;
+		yuv[2 * n + i] = (112 * r - 94 * g - 18 * b + 32896) >> 8;
+	}
+}
+
+bool
+y4m_write_header(FILE *f, int width, int height, int fps)
+{
+	return fprintf(f, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C444\n", width,
+	    height, fps) > 0;
+}
+
+bool
+y4m_write_frame(FILE *f, uint8_t const *yuv, int width, int height)
+{
+	size_t n = (size_t)width * height * 3;
+	return fputs("FRAME\n", f) != EOF && fwrite(yuv, 1, n, f) == n;
+}
+
+static bool
+start_png(ImageWriter *w)
+{
+	if (setjmp(png_jmpbuf(w->png))) {
+		return false;
+	}
+	png_init_io(w->png, w->file);
+	png_set_IHDR(w->png, w->info, w->width, w->height, 8,
+	    PNG_COLOR_TYPE_RGB, PNG_INTERLACE_NONE,
+	    PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+	png_write_info(w->png, w->info);
+	return true;
+}
+
+static bool
+finish_png(ImageWriter *w)
+{
+	if (setjmp(png_jmpbuf(w->png))) {
+		return false;
+	}
+	png_write_end(w->png, NULL);
+	return true;
+}
+
+static bool
+has_suffix(char const *s, char const *suffix)
+{
+	size_t n = strlen(s), m = strlen(suffix);
+	return n >= m && strcmp(s + n - m, suffix) == 0;
+}
@@ -0,0 +1,35 @@
+// Copyright (c) 2025 Charles Hood <chood@chood.net>
+//
+// This program is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef IMAGE_H
+#define IMAGE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+typedef struct ImageWriter ImageWriter;
+
+ImageWriter *image_create(char const *, int, int);
+bool image_write(ImageWriter *, uint8_t const *, int);
+bool image_close(ImageWriter *);
+bool image_read(char const *, int, int, uint8_t *);
+bool image_encode_png(uint8_t const *, int, int, uint8_t **, size_t *);
+void rgba_to_yuv(uint8_t const *, int, int, uint8_t *);
+bool y4m_write_header(FILE *, int, int, int);
+bool y4m_write_frame(FILE *, uint8_t const *, int, int);
+
+#endif
@@ -0,0 +1,313 @@
+// Copyright (c) 2025 Charles Hood <chood@chood.net>
+//
+// This program is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <SDL3/SDL.h>
+#include "image.h"
+#include "iterfile.h"
+#include "pool.h"
+
+#define ITERFILE_MAGIC "MBITERS1"
+#define ITERFILE_BAND_ROWS 16
+
+// The file is this header followed by planes of counts, smooth counts, pairs
+// of z and distance estimates, top row first and in host byte order.
+typedef struct {
+	char magic[8];
+	uint32_t formula;
+	uint32_t iterations;
+	uint32_t width;
+	uint32_t height;
+	double view[4];
+	uint64_t reserved;
+} Header;
+
+typedef struct {
+	IterFile *file;
+	int y;
+} Band;
+
+static size_t file_size(int, int);
+static void bind_planes(IterFile *);
+static void sample_band(void *);
+static void usage(void);
+
+// Samples every pixel of a view straight into a new memory-mapped file, in
+// parallel bands of rows.
+bool
+iterfile_render(char const *path, View const *view, int iterations,
+    int width, int height)
+{
+	size_t size = file_size(width, height);
+	int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd == -1) {
+		return false;
+	}
+	void *map = MAP_FAILED;
+	if (posix_fallocate(fd, 0, size) == 0) {
+		map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd,
+		    0);
+	}
+	close(fd);
+	if (map == MAP_FAILED) {
+		remove(path);
+		return false;
+	}
+
+	Header *h = map;
+	memset(h, 0, sizeof(Header));
+	memcpy(h->magic, ITERFILE_MAGIC, sizeof(h->magic));
+	h->formula = RENDER_FORMULA;
+	h->iterations = iterations;
+	h->width = width;
+	h->height = height;
+	h->view[0] = view->x;
+	h->view[1] = view->y;
+	h->view[2] = view->width;
+	h->view[3] = view->height;
+
+	IterFile f;
+	f.view = *view;
+	f.iterations = iterations;
+	f.width = width;
+	f.height = height;
+	f.map = map;
+	bind_planes(&f);
+
+	Pool *pool = pool_create(0);
+	int count = (height + ITERFILE_BAND_ROWS - 1) / ITERFILE_BAND_ROWS;
+	Band *bands = malloc(count * sizeof(Band));
+	if (pool == NULL || bands == NULL) {
+		exit(EXIT_FAILURE);
+	}
+	for (int i = 0; i < count; ++i) {
+		bands[i].file = &f;
+		bands[i].y = i * ITERFILE_BAND_ROWS;
+		pool_submit(pool, sample_band, &bands[i]);
+	}
+	pool_destroy(pool);
+	free(bands);
+	return munmap(map, size) == 0;
+}
+
+// Returns NULL if the file is missing, damaged or was made with another
+// iteration formula.
+IterFile *
+iterfile_open(char const *path)
+{
+	int fd = open(path, O_RDONLY);
+	if (fd == -1) {
+		return NULL;
+	}
+	struct stat st;
+	void *map = MAP_FAILED;
+	if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(Header)) {
+		map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	}
+	close(fd);
+	if (map == MAP_FAILED) {
+		return NULL;
+	}
+
+	Header const *h = map;
+	IterFile *f = malloc(sizeof(IterFile));
+	if (f == NULL || memcmp(h->magic, ITERFILE_MAGIC,
+	    sizeof(h->magic)) != 0 || h->formula != RENDER_FORMULA ||
+	    h->width == 0 || h->height == 0 || h->width > 1 << 20 ||
+	    h->height > 1 << 20 ||
+	    file_size(h->width, h->height) != (size_t)st.st_size) {
+		free(f);
+		munmap(map, st.st_size);
+		return NULL;
+	}
+	f->view.x = h->view[0];
+	f->view.y = h->view[1];
+	f->view.width = h->view[2];
+	f->view.height = h->view[3];
+	f->iterations = h->iterations;
+	f->width = h->width;
+	f->height = h->height;
+	f->map = map;
+	f->map_size = st.st_size;
+	bind_planes(f);
+	return f;
+}
+
+void
+iterfile_close(IterFile *f)
+{
+	munmap(f->map, f->map_size);
+	free(f);
+}
+
+// Colors rows y to y + rows of a file into RGBA pixels, first row first.
+void
+iterfile_colorize(IterFile const *f, Palette palette, int y, int rows,
+    uint8_t *rgba)
+{
+	size_t start = (size_t)y * f->width, n = (size_t)rows * f->width;
+	double pixel_size = 2. * f->view.height / f->height;
+	for (size_t i = 0; i < n; ++i) {
+		uint8_t *p = &rgba[4 * i];
+		p[3] = 255;
+		if (f->counts[start + i] >= (uint32_t)f->iterations) {
+			uint8_t v = palette == PALETTE_BINARY ? 255 : 0;
+			p[0] = p[1] = p[2] = v;
+			continue;
+		}
+		switch (palette) {
+		case PALETTE_BINARY:
+			p[0] = p[1] = 0;
+			p[2] = 127;
+			break;
+		case PALETTE_SMOOTH: {
+			double t = .05 * f->smooth[start + i];
+			for (int j = 0; j < 3; ++j) {
+				p[j] = 127.5 + 127.5 *
+				    cos(2. * SDL_PI_D * (t + .15 * j));
+			}
+			break;
+		}
+		case PALETTE_DISTANCE: {
+			double d = f->distance[start + i] / pixel_size;
+			p[0] = p[1] = p[2] = 255. * SDL_min(1., pow(d, .25));
+			break;
+		}
+		}
+	}
+}
+
+bool
+palette_parse(char const *name, Palette *palette)
+{
+	char const *names[] = {"binary", "smooth", "distance"};
+	for (int i = 0; i < 3; ++i) {
+		if (strcmp(name, names[i]) == 0) {
+			*palette = i;
+			return true;
+		}
+	}
+	return false;
+}
+
+// Colors an iteration file into an image. Only the planes that the palette
+// needs are read, so this is mostly bound by reading the file.
+int
+recolor_main(int argc, char **argv)
+{
+	Palette palette = PALETTE_SMOOTH;
+	char const *path = NULL;
+	int c;
+	while ((c = getopt(argc, argv, "o:p:")) != -1) {
+		switch (c) {
+		case 'o':
+			path = optarg;
+			break;
+		case 'p':
+			if (!palette_parse(optarg, &palette)) {
+				usage();
+			}
+			break;
+		default:
+			usage();
+		}
+	}
+	if (path == NULL || optind != argc - 1) {
+		usage();
+	}
+
+	IterFile *f = iterfile_open(argv[optind]);
+	if (f == NULL) {
+		fprintf(stderr, "%s: not an iteration file\n", argv[optind]);
+		return EXIT_FAILURE;
+	}
+	posix_madvise(f->map, f->map_size, POSIX_MADV_SEQUENTIAL);
+	ImageWriter *w = image_create(path, f->width, f->height);
+	uint8_t *rgba = malloc((size_t)f->width * ITERFILE_BAND_ROWS * 4);
+	if (w == NULL || rgba == NULL) {
+		fprintf(stderr, "%s: cannot create image\n", path);
+		return EXIT_FAILURE;
+	}
+	for (int y = 0; y < f->height; y += ITERFILE_BAND_ROWS) {
+		int rows = SDL_min(ITERFILE_BAND_ROWS, f->height - y);
+		iterfile_colorize(f, palette, y, rows, rgba);
+		if (!image_write(w, rgba, rows)) {
+			break;
+		}
+	}
+	if (!image_close(w)) {
+		fprintf(stderr, "%s: cannot write image\n", path);
+		return EXIT_FAILURE;
+	}
+	free(rgba);
+	iterfile_close(f);
+	return EXIT_SUCCESS;
+}
+
+static size_t
+file_size(int width, int height)
+{
+	return sizeof(Header) + (size_t)width * height * 5 * 4;
+}
+
+static void
+bind_planes(IterFile *f)
+{
+	size_t n = (size_t)f->width * f->height;
+	f->counts = (uint32_t *)((Header *)f->map + 1);
+	f->smooth = (float *)(f->counts + n);
+	f->z = f->smooth + n;
+	f->distance = f->z + 2 * n;
+}
+
+static void
+sample_band(void *data)
+{
+	Band *b = data;
+	IterFile *f = b->file;
+	Canvas c = {f->view, f->iterations, f->width, f->height, NULL};
+	int end = SDL_min(b->y + ITERFILE_BAND_ROWS, f->height);
+	for (int y = b->y; y < end; ++y) {
+		for (int x = 0; x < f->width; ++x) {
+			size_t i = (size_t)y * f->width + x;
+			double p[2];
+			Sample s;
+			canvas_point(&c, x, y, p);
+			sample(p[0], p[1], f->iterations, &s);
+			f->counts[i] = s.count;
+			f->smooth[i] = s.smooth;
+			f->z[2 * i] = s.z[0];
+			f->z[2 * i + 1] = s.z[1];
+			f->distance[i] = s.distance;
+		}
+	}
+}
+
+static void
+usage(void)
+{
+	fprintf(stderr, "usage: mandelbrot recolor [-p binary|smooth|distance] "
+	    "-o file file.mbi\n");
+	exit(EXIT_FAILURE);
+}
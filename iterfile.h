@@ -0,0 +1,51 @@
+// Copyright (c) 2025 Charles Hood <chood@chood.net>
+//
+// This program is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef ITERFILE_H
+#define ITERFILE_H
+
+#include <stddef.h>
+#include "render.h"
+
+typedef enum {
+	PALETTE_BINARY,
+	PALETTE_SMOOTH,
+	PALETTE_DISTANCE,
+} Palette;
+
+// An iteration file keeps every value of Sample for each pixel of a view so
+// that it can be colored again without iterating. Files are memory-mapped
+// read-only; the planes point into the mapping.
+typedef struct {
+	View view;
+	int iterations;
+	int width;
+	int height;
+	uint32_t *counts;
+	float *smooth;
+	float *z;
+	float *distance;
+	void *map;
+	size_t map_size;
+} IterFile;
+
+bool iterfile_render(char const *, View const *, int, int, int);
+IterFile *iterfile_open(char const *);
+void iterfile_close(IterFile *);
+void iterfile_colorize(IterFile const *, Palette, int, int, uint8_t *);
+bool palette_parse(char const *, Palette *);
+int recolor_main(int, char **);
+
+#endif
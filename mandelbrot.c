@@ -14,9 +14,44 @@
 // this program. If not, see <https://www.gnu.org/licenses/>.
 
 #include <math.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
 #include <SDL3/SDL.h>
 #include <GLES3/gl3.h>
+#include "bench.h"
+#include "check.h"
+#include "cluster.h"
+#include "codec.h"
+#include "control.h"
+#include "expmap.h"
+#include "golden.h"
+#include "headless.h"
+#include "hud.h"
+#include "image.h"
+#include "iterfile.h"
+#include "movie.h"
+#include "poster.h"
+#include "pyramid.h"
+#include "readback.h"
+#include "render.h"
+#include "renderer.h"
+#include "ring.h"
+#include "screenshot.h"
+#include "server.h"
+#include "shader.h"
+#include "trace.h"
+
+#define CONTROL_PATH_BYTES 256
+
+// The largest frame that is published to shared memory
+#define FRAME_RING_WIDTH 3840
+#define FRAME_RING_HEIGHT 2160
+#define FRAME_RING_READBACKS 3
+
+// Shift+P renders screenshots at this multiple of the window's size.
+#define SCREENSHOT_SCALE 2
 
 typedef enum {
 	MOUSE_MODE_NONE,
@@ -24,19 +59,48 @@ typedef enum {
 	MOUSE_MODE_PAN,
 } MouseMode;
 
+typedef struct {
+	GLuint program;
+	GLint transformation_uniform;
+	GLint selection_uniform;
+} Program;
+
 typedef struct {
 	SDL_Window *window;
 	int window_width;
 	int window_height;
-	GLint transformation_uniform;
-	GLint selection_uniform;
+	Program mandelbrot_program;
+	Program image_program;
+	GLuint texture;
+
+	View focus;
+	int iterations;
+	bool cpu;
+	RenderMode render_mode;
+	bool heatmap;
+	Renderer *renderer;
+	FrameRequest requested;
+	int generation;
+	bool frame_complete;
+	View image_view;
+	int image_width;
+	int image_height;
+	bool showing_file;
+
+	Control *control;
+	Uint32 control_event;
+	ControlCommand render_command;
+	bool rendering;
+	Uint64 render_start;
+
+	FrameRing *ring;
+	Readback *ring_readback;
+	Screenshots *screenshots;
+	Readback *screenshot_readback;
+	bool screenshot_requested;
 
-	struct {
-		float x;
-		float y;
-		float width;
-		float height;
-	} focus;
+	Hud *hud;
+	bool show_hud;
 
 	MouseMode mouse_mode;
 	int mouse_down_x;
@@ -45,49 +109,78 @@ typedef struct {
 	int mouse_y;
 } App;
 
-static void initialize(App *);
-static GLuint create_program(char const *, char const *);
-static GLuint create_shader(GLenum, char const *);
+static void usage(void);
+static void initialize(App *, size_t, Store *, char const *,
+    char const *);
+static bool load_program(Program *, char const *, char const *);
+static void open_file(App *, char const *);
+static void save_file(App *);
+static void run_commands(App *);
+static void run_command(App *, ControlCommand *);
+static void set_size(App *, int, int);
+static void finish_render(App *);
+static void capture_frame(App *);
+static void publish_frame(uint8_t const *, int, int, void *);
+static void save_screenshot(uint8_t const *, int, int, void *);
+static void render_screenshot(App *);
+static void screenshot_path(char *, size_t, char const *);
+static bool poll_readbacks(App *);
+static void wait_event(App *, SDL_Event *);
 static void draw(App *);
-static void get_transformation(App *, float *);
-static void get_selection(App *, float const *, float *);
-static void transform(float const *, float *);
+static void request_frame(App *, View const *);
+static void present_frame(App *);
+static void get_transformation(App *, View *);
+static void get_selection(App *, View const *, double *);
+static void transform(View const *, double *);
+static void untransform(View const *, double *);
 static int cmp_int(void const *, void const *);
 static void handle_event(App *, SDL_Event const *);
+static void handle_key(App *, SDL_KeyboardEvent const *);
 static void set_focus_from_selection(App *);
-static void zoom(App *, float);
+static void zoom(App *, double);
 static void pan(App *, int, int);
 
-static char const vert_shader_source[] = "\
+static char const frag_shader_source[] = "\
 #version 300 es\n\
+precision highp float;\n\
 \n\
-uniform vec4 transformation;\n\
-\n\
-out vec2 frag_position;\n\
+uniform vec4 selection;\n\
 \n\
-const vec2 vertices[] = vec2[](\n\
-	vec2(-1., -1.),\n\
-	vec2( 1., -1.),\n\
-	vec2(-1.,  1.),\n\
-	vec2( 1.,  1.)\n\
-);\n\
+in vec2 frag_position;\n\
 \n\
-const int indices[] = int[](0, 1, 2, 3, 2, 1);\n\
+out vec4 out_color;\n\
 \n\
 void\n\
 main()\n\
 {\n\
-	vec2 p = vertices[indices[gl_VertexID]];\n\
-	gl_Position = vec4(p, 0., 1.);\n\
-	frag_position = transformation.zw * p + transformation.xy;\n\
+	vec2 p = frag_position;\n\
+\n\
+	vec3 color = vec3(0., 0., .5);\n\
+\n\
+	vec2 z = p;\n\
+	for (int i = 0; i < 256; ++i) {\n\
+		z = vec2(z.x * z.x - z.y * z.y + p.x, 2. * z.x * z.y + p.y);\n\
+	}\n\
+\n\
+	float limit = 3.;\n\
+	if (-limit < z.x && z.x < limit && -limit < z.y && z.y < limit) {\n\
+		color = vec3(1.);\n\
+	}\n\
+\n\
+	if (selection.x <= p.x && p.x <= selection.z &&\n\
+	    selection.y <= p.y && p.y <= selection.w) {\n\
+		color = vec3(1.) - color;\n\
+	}\n\
+	out_color = vec4(color, 1.);\n\
 }\n\
 ";
 
-static char const frag_shader_source[] = "\
+static char const image_frag_shader_source[] = "\
 #version 300 es\n\
 precision highp float;\n\
 \n\
 uniform vec4 selection;\n\
+uniform sampler2D image;\n\
 \n\
 in vec2 frag_position;\n\
 \n\
@@ -98,16 +191,11 @@ main()\n\
 {\n\
 	vec2 p = frag_position;\n\
 \n\
-	vec3 color = vec3(0., 0., .5);\n\
+	vec3 color = vec3(0.);\n\
 \n\
-	vec2 z = p;\n\
-	for (int i = 0; i < 256; ++i) {\n\
-		z = vec2(z.x * z.x - z.y * z.y + p.x, 2. * z.x * z.y + p.y);\n\
-	}\n\
-\n\
-	float limit = 3.;\n\
-	if (-limit < z.x && z.x < limit && -limit < z.y && z.y < limit) {\n\
-		color = vec3(1.);\n\
+	vec2 uv = (p + 1.) * .5;\n\
+	if (0. <= uv.x && uv.x <= 1. && 0. <= uv.y && uv.y <= 1.) {\n\
+		color = texture(image, vec2(uv.x, 1. - uv.y)).rgb;\n\
 	}\n\
 \n\
 	if (selection.x <= p.x && p.x <= selection.z &&\n\
@@ -119,32 +207,200 @@ main()\n\
 ";
 
 int
-main(void)
+main(int argc, char **argv)
 {
+	if (argc > 1 && strcmp(argv[1], "bench") == 0) {
+		return bench_main(argc - 1, argv + 1);
+	}
+	if (argc > 1 && strcmp(argv[1], "check") == 0) {
+		return check_main(argc - 1, argv + 1);
+	}
+	if (argc > 1 && strcmp(argv[1], "codec") == 0) {
+		return codec_main(argc - 1, argv + 1);
+	}
+	if (argc > 1 && strcmp(argv[1], "frames") == 0) {
+		return frames_main(argc - 1, argv + 1);
+	}
+	if (argc > 1 && strcmp(argv[1], "compact") == 0) {
+		return compact_main(argc - 1, argv + 1);
+	}
+	if (argc > 1 && strcmp(argv[1], "render") == 0) {
+		return render_main(argc - 1, argv + 1);
+	}
+	if (argc > 1 && strcmp(argv[1], "poster") == 0) {
+		return poster_main(argc - 1, argv + 1);
+	}
+	if (argc > 1 && strcmp(argv[1], "pyramid") == 0) {
+		return pyramid_main(argc - 1, argv + 1);
+	}
+	if (argc > 1 && strcmp(argv[1], "movie") == 0) {
+		return movie_main(argc - 1, argv + 1);
+	}
+	if (argc > 1 && strcmp(argv[1], "expmap") == 0) {
+		return expmap_main(argc - 1, argv + 1);
+	}
+	if (argc > 1 && strcmp(argv[1], "recolor") == 0) {
+		return recolor_main(argc - 1, argv + 1);
+	}
+	if (argc > 1 && strcmp(argv[1], "coordinator") == 0) {
+		return coordinator_main(argc - 1, argv + 1);
+	}
+	if (argc > 1 && strcmp(argv[1], "worker") == 0) {
+		return worker_main(argc - 1, argv + 1);
+	}
+	if (argc > 1 && strcmp(argv[1], "serve") == 0) {
+		return serve_main(argc - 1, argv + 1);
+	}
+	if (argc > 1 && strcmp(argv[1], "test") == 0) {
+		return golden_main(argc - 1, argv + 1);
+	}
+
+	size_t cache_size = 256, store_size = 4096;
+	char const *store_path = NULL, *file_path = NULL, *control_path = NULL;
+	char const *ring_name = NULL, *trace_path = NULL;
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+			control_path = argv[++i];
+		} else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+			ring_name = argv[++i];
+		} else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
+			cache_size = strtoul(argv[++i], NULL, 10);
+		} else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+			store_path = argv[++i];
+		} else if (strcmp(argv[i], "-S") == 0 && i + 1 < argc) {
+			store_size = strtoul(argv[++i], NULL, 10);
+		} else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+			trace_path = argv[++i];
+		} else if (argv[i][0] != '-' && file_path == NULL) {
+			file_path = argv[i];
+		} else {
+			usage();
+		}
+	}
+
+	Store *store = NULL;
+	if (store_path != NULL) {
+		store = store_open(store_path, store_size << 20);
+		if (store == NULL) {
+			fprintf(stderr, "%s: cannot open store, or it is in "
+			    "use\n", store_path);
+			return EXIT_FAILURE;
+		}
+	}
+
+	// Tracing has to start before the render threads do.
+	if (trace_path != NULL && !trace_open(trace_path)) {
+		return EXIT_FAILURE;
+	}
+	trace_thread("main");
+
 	App app;
-	initialize(&app);
+	initialize(&app, cache_size << 20, store, control_path, ring_name);
+	if (file_path != NULL) {
+		open_file(&app, file_path);
+	}
 
+	// The event time of a frame includes handling the event that woke the
+	// loop, but not waiting for it.
+	Uint64 handled = 0;
 	for (;;) {
+		Uint64 start = SDL_GetTicksNS();
+		Uint64 span = trace_begin();
 		SDL_Event e;
 		while (SDL_PollEvent(&e)) {
 			handle_event(&app, &e);
 		}
+		run_commands(&app);
+		trace_end("events", span);
 
+		Uint64 draw_start = SDL_GetTicksNS();
+		span = trace_begin();
+		bool show_hud = app.show_hud;
+		if (show_hud) {
+			hud_begin_draw(app.hud);
+		}
 		draw(&app);
+		if (show_hud) {
+			hud_end_draw(app.hud);
+		}
+		finish_render(&app);
+		capture_frame(&app);
+		if (show_hud) {
+			hud_draw(app.hud, app.window_width,
+			    app.window_height);
+		}
+		trace_end("draw", span);
 
+		Uint64 swap_start = SDL_GetTicksNS();
+		span = trace_begin();
 		if (!SDL_GL_SwapWindow(app.window)) {
 			exit(EXIT_FAILURE);
 		}
-
-		if (!SDL_WaitEvent(&e)) {
-			exit(EXIT_FAILURE);
+		trace_end("swap", span);
+		Uint64 swap_end = SDL_GetTicksNS();
+		if (show_hud) {
+			hud_record(app.hud, draw_start - start + handled,
+			    swap_start - draw_start, swap_end - swap_start);
 		}
+
+		wait_event(&app, &e);
+		Uint64 woken = SDL_GetTicksNS();
+		span = trace_begin();
 		handle_event(&app, &e);
+		trace_end("events", span);
+		handled = SDL_GetTicksNS() - woken;
 	}
 }
 
 static void
-initialize(App *app)
+usage(void)
+{
+	fprintf(stderr, "usage: mandelbrot [-c control-socket] [-f frame-ring] "
+	    "[-m cache-megabytes]\n"
+	    "                  [-s store] [-S store-megabytes] [-t trace.json] "
+	    "[file.mbi]\n"
+	    "       mandelbrot bench [-b backend]... [-f csv|json] "
+	    "[-g WIDTHxHEIGHT] [-n runs]\n"
+	    "                        [view...]\n"
+	    "       mandelbrot check [view...]\n"
+	    "       mandelbrot codec\n"
+	    "       mandelbrot compact store\n"
+	    "       mandelbrot frames [-n frames] [-r fps] frame-ring > "
+	    "file.y4m\n"
+	    "       mandelbrot recolor [-p binary|smooth|distance] -o file "
+	    "file.mbi\n"
+	    "       mandelbrot render [-b cpu|gpu] [-c x,y] [-s scale] "
+	    "[-g WIDTHxHEIGHT]\n"
+	    "                         [-i iterations] [-m mode] -o file\n"
+	    "       mandelbrot poster [render options] [-r band-rows] "
+	    "[-C checkpoint [-R]] -o file\n"
+	    "       mandelbrot pyramid [-f xyz|dzi] [-c x,y] [-s scale] "
+	    "[-z min,max]\n"
+	    "                          [-i iterations] [-m mode] -o path\n"
+	    "       mandelbrot movie [-f x,y,scale] [-c x,y] [-s scale] "
+	    "[-n frames] [-r fps]\n"
+	    "                        [-g WIDTHxHEIGHT] [-i iterations] "
+	    "[-m mode]\n"
+	    "                        [-k [-O oversampling] [-b cpu|gpu]]\n"
+	    "       mandelbrot expmap [-b cpu|gpu] [-S start-scale] [-c x,y] "
+	    "[-s scale]\n"
+	    "                         [-n frames] [-r fps] [-g WIDTHxHEIGHT] "
+	    "[-i iterations]\n"
+	    "                         [-m mode]\n"
+	    "       mandelbrot coordinator [render options] [-l address] "
+	    "[-t seconds]\n"
+	    "                              [-w local-workers] -o file\n"
+	    "       mandelbrot worker [-b cpu|gpu] address\n"
+	    "       mandelbrot serve [-c x,y] [-s scale] [-i iterations] "
+	    "[-m mode]\n"
+	    "                        [-M cache-megabytes] [-l address]\n"
+	    "       mandelbrot test [-d directory] [-u] [view...]\n");
+	exit(EXIT_FAILURE);
+}
+
+static void
+initialize(App *app, size_t cache_size, Store *store,
+    char const *control_path, char const *ring_name)
 {
 	if (!SDL_Init(SDL_INIT_VIDEO)) {
 		exit(EXIT_FAILURE);
@@ -176,16 +432,9 @@ initialize(App *app)
 		exit(EXIT_FAILURE);
 	}
 
-	GLuint program = create_program(vert_shader_source, frag_shader_source);
-	if (program == 0) {
-		exit(EXIT_FAILURE);
-	}
-	glUseProgram(program);
-
-	app->transformation_uniform =
-	    glGetUniformLocation(program, "transformation");
-	app->selection_uniform = glGetUniformLocation(program, "selection");
-	if (app->transformation_uniform == -1 || app->selection_uniform == -1) {
+	if (!load_program(&app->mandelbrot_program, vert_shader_source,
+	    frag_shader_source) || !load_program(&app->image_program,
+	    vert_shader_source, image_frag_shader_source)) {
 		exit(EXIT_FAILURE);
 	}
 	glViewport(0, 0, app->window_width, app->window_height);
@@ -194,103 +443,532 @@ initialize(App *app)
 	glGenVertexArrays(1, &vertex_array);
 	glBindVertexArray(vertex_array);
 
-	app->focus.x = 0.f;
-	app->focus.y = 0.f;
-	app->focus.width = 1.f;
-	app->focus.height = 1.f;
+	glGenTextures(1, &app->texture);
+	glBindTexture(GL_TEXTURE_2D, app->texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	app->focus.x = 0.;
+	app->focus.y = 0.;
+	app->focus.width = 1.;
+	app->focus.height = 1.;
+
+	app->iterations = 256;
+	app->cpu = false;
+	app->render_mode = RENDER_MODE_BRUTE;
+	app->heatmap = false;
+	memset(&app->requested, 0, sizeof(FrameRequest));
+	app->image_width = 0;
+	app->image_height = 0;
+	app->showing_file = false;
+	app->generation = 0;
+	app->frame_complete = false;
+
+	Uint32 event_type = SDL_RegisterEvents(1);
+	if (event_type == 0) {
+		exit(EXIT_FAILURE);
+	}
+	app->renderer = renderer_create(event_type, cache_size, store);
+	if (app->renderer == NULL) {
+		exit(EXIT_FAILURE);
+	}
 
 	app->mouse_mode = MOUSE_MODE_NONE;
+
+	app->control = NULL;
+	app->rendering = false;
+	if (control_path != NULL) {
+		app->control_event = SDL_RegisterEvents(1);
+		app->control = app->control_event != 0 ?
+		    control_open(control_path, app->control_event) : NULL;
+		if (app->control == NULL) {
+			fprintf(stderr, "%s: cannot listen\n", control_path);
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	app->ring = NULL;
+	app->ring_readback = NULL;
+	if (ring_name != NULL) {
+		app->ring = ring_create(ring_name, FRAME_RING_WIDTH,
+		    FRAME_RING_HEIGHT);
+		if (app->ring == NULL) {
+			fprintf(stderr, "%s: cannot create shared memory\n",
+			    ring_name);
+			exit(EXIT_FAILURE);
+		}
+		app->ring_readback = readback_create(FRAME_RING_READBACKS);
+		if (app->ring_readback == NULL) {
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	// Two buffers let a screenshot start while the last one is still
+	// being read.
+	app->screenshots = screenshots_create();
+	app->screenshot_readback = readback_create(2);
+	if (app->screenshots == NULL || app->screenshot_readback == NULL) {
+		exit(EXIT_FAILURE);
+	}
+	app->screenshot_requested = false;
+
+	app->hud = hud_create();
+	if (app->hud == NULL) {
+		exit(EXIT_FAILURE);
+	}
+	app->show_hud = false;
 }
 
-static GLuint
-create_program(char const *vert_source, char const *frag_source)
+static bool
+load_program(Program *p, char const *vert_source, char const *frag_source)
 {
-	GLuint vert = create_shader(GL_VERTEX_SHADER, vert_source);
-	GLuint frag = create_shader(GL_FRAGMENT_SHADER, frag_source);
-	GLuint program = glCreateProgram();
-	if (vert == 0 || frag == 0 || program == 0) {
-		glDeleteShader(vert);
-		glDeleteShader(frag);
-		glDeleteProgram(program);
-		return 0;
+	p->program = create_program(vert_source, frag_source);
+	if (p->program == 0) {
+		return false;
 	}
 
-	glAttachShader(program, vert);
-	glAttachShader(program, frag);
-	glLinkProgram(program);
+	p->transformation_uniform =
+	    glGetUniformLocation(p->program, "transformation");
+	p->selection_uniform = glGetUniformLocation(p->program, "selection");
+	return p->transformation_uniform != -1 && p->selection_uniform != -1;
+}
+
+// Shows an iteration file instead of rendering until another render mode is
+// chosen.
+static void
+open_file(App *app, char const *path)
+{
+	IterFile *f = iterfile_open(path);
+	if (f == NULL) {
+		fprintf(stderr, "%s: not an iteration file\n", path);
+		exit(EXIT_FAILURE);
+	}
+	GLint max_size;
+	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_size);
+	if (f->width > max_size || f->height > max_size) {
+		fprintf(stderr, "%s: %dx%d is larger than the largest texture "
+		    "of %d pixels, use mandelbrot recolor instead\n", path,
+		    f->width, f->height, max_size);
+		exit(EXIT_FAILURE);
+	}
+	uint8_t *rgba = malloc((size_t)f->width * f->height * 4);
+	if (rgba == NULL) {
+		exit(EXIT_FAILURE);
+	}
+	iterfile_colorize(f, PALETTE_BINARY, 0, f->height, rgba);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, f->width, f->height, 0,
+	    GL_RGBA, GL_UNSIGNED_BYTE, rgba);
+	free(rgba);
 
-	glDeleteShader(vert);
-	glDeleteShader(frag);
+	app->focus = f->view;
+	app->iterations = f->iterations;
+	app->image_view = f->view;
+	app->image_width = f->width;
+	app->image_height = f->height;
+	app->showing_file = true;
+	app->requested.width = 0;
+	iterfile_close(f);
+}
 
-	GLint status = GL_FALSE;
-	glGetProgramiv(program, GL_LINK_STATUS, &status);
-	if (!status) {
-		glDeleteProgram(program);
-		return 0;
+// Queues the iterations of the current view at the size of the window to be
+// saved by the screenshot thread, so that the window keeps responding.
+static void
+save_file(App *app)
+{
+	char path[64];
+	screenshot_path(path, sizeof(path), "mbi");
+
+	Canvas c;
+	get_transformation(app, &c.view);
+	c.iterations = app->iterations;
+	c.width = app->window_width;
+	c.height = app->window_height;
+	c.counts = NULL;
+	if (!screenshots_iterations(app->screenshots, path, &c)) {
+		fprintf(stderr, "iteration file dropped, still saving earlier "
+		    "screenshots\n");
+	}
+}
+
+// Applies queued control commands up to the next render, so that any number
+// of changes that come before it cost one frame. Commands after the render
+// wait until it has been answered.
+static void
+run_commands(App *app)
+{
+	ControlCommand command;
+	while (app->control != NULL && !app->rendering &&
+	    control_next(app->control, &command)) {
+		run_command(app, &command);
+	}
+}
+
+static void
+run_command(App *app, ControlCommand *command)
+{
+	char name[16], extra;
+	int n = 0;
+	if (sscanf(command->line, "%15s%n", name, &n) != 1) {
+		control_reply(command, "error unknown command");
+		control_release(command);
+		return;
+	}
+	char const *args = command->line + n;
+
+	double p[3];
+	int size[2];
+	RenderMode mode;
+	if (strcmp(name, "view") == 0) {
+		if (sscanf(args, "%lf %lf %lf %c", &p[0], &p[1], &p[2],
+		    &extra) == 3 && p[2] > 0.) {
+			app->focus.x = p[0];
+			app->focus.y = p[1];
+			app->focus.width = app->focus.height = p[2];
+			control_reply(command, "ok");
+		} else {
+			control_reply(command, "error usage: view x y scale");
+		}
+	} else if (strcmp(name, "iterations") == 0) {
+		if (sscanf(args, "%d %c", &size[0], &extra) == 1 &&
+		    size[0] > 0) {
+			app->iterations = size[0];
+			control_reply(command, "ok");
+		} else {
+			control_reply(command, "error usage: iterations n");
+		}
+	} else if (strcmp(name, "size") == 0) {
+		if (sscanf(args, "%dx%d %c", &size[0], &size[1],
+		    &extra) == 2 && size[0] > 0 && size[1] > 0) {
+			set_size(app, size[0], size[1]);
+			control_reply(command, "ok %dx%d", app->window_width,
+			    app->window_height);
+		} else {
+			control_reply(command,
+			    "error usage: size WIDTHxHEIGHT");
+		}
+	} else if (strcmp(name, "mode") == 0) {
+		if (sscanf(args, "%15s %c", name, &extra) == 1 &&
+		    (strcmp(name, "gpu") == 0 ||
+		    render_mode_parse(name, &mode))) {
+			app->cpu = strcmp(name, "gpu") != 0;
+			app->render_mode = app->cpu ? mode : app->render_mode;
+			app->showing_file = false;
+			control_reply(command, "ok");
+		} else {
+			control_reply(command,
+			    "error usage: mode gpu|brute|trace|guess");
+		}
+	} else if (strcmp(name, "render") == 0) {
+		app->render_command = *command;
+		app->rendering = true;
+		app->render_start = SDL_GetTicksNS();
+		return;
+	} else {
+		control_reply(command, "error unknown command");
+	}
+	control_release(command);
+}
+
+// Resizes the window right away rather than when the window manager gets
+// around to it, so that the next render has the new size.
+static void
+set_size(App *app, int width, int height)
+{
+	SDL_SetWindowSize(app->window, width, height);
+	SDL_SyncWindow(app->window);
+	if (SDL_GetWindowSizeInPixels(app->window, &app->window_width,
+	    &app->window_height)) {
+		glViewport(0, 0, app->window_width, app->window_height);
+	}
+}
+
+// Answers a render command once the frame that was just drawn shows the whole
+// view, either by writing it to the path given with the command or by
+// sending its RGBA pixels after the reply.
+static void
+finish_render(App *app)
+{
+	if (!app->rendering || (app->cpu && !app->showing_file &&
+	    !app->frame_complete)) {
+		return;
+	}
+
+	ControlCommand *command = &app->render_command;
+	double milliseconds = (SDL_GetTicksNS() - app->render_start) / 1e6;
+	int w = app->window_width, h = app->window_height;
+	size_t stride = (size_t)w * 4;
+	uint8_t *rgba = malloc(stride * h);
+	uint8_t *row = malloc(stride);
+	if (rgba == NULL || row == NULL) {
+		exit(EXIT_FAILURE);
+	}
+	glReadPixels(0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, rgba);
+	for (int y = 0; y < h / 2; ++y) {
+		memcpy(row, rgba + y * stride, stride);
+		memcpy(rgba + y * stride, rgba + (h - 1 - y) * stride,
+		    stride);
+		memcpy(rgba + (h - 1 - y) * stride, row, stride);
+	}
+
+	char path[CONTROL_PATH_BYTES];
+	if (sscanf(command->line, "%*s %255s", path) == 1) {
+		ImageWriter *writer = image_create(path, w, h);
+		bool ok = writer != NULL && image_write(writer, rgba, h);
+		if (writer != NULL) {
+			ok &= image_close(writer);
+		}
+		if (ok) {
+			control_reply(command, "ok %.1f %dx%d %s",
+			    milliseconds, w, h, path);
+		} else {
+			control_reply(command, "error cannot write %s", path);
+		}
+	} else if (control_reply(command, "ok %.1f %dx%d %zu", milliseconds,
+	    w, h, stride * h)) {
+		control_send(command, rgba, stride * h);
+	}
+	free(row);
+	free(rgba);
+	control_release(command);
+	app->rendering = false;
+
+	if (control_pending(app->control)) {
+		SDL_Event e;
+		SDL_zero(e);
+		e.type = app->control_event;
+		SDL_PushEvent(&e);
+	}
+}
+
+// Starts copying the frame that was just drawn for the frame ring and for a
+// screenshot that was asked for. Copies are handed on once the GPU has
+// finished them, and a frame is dropped if too many earlier ones are still
+// in flight.
+static void
+capture_frame(App *app)
+{
+	poll_readbacks(app);
+	int w = app->window_width, h = app->window_height;
+	if (app->ring != NULL) {
+		readback_start(app->ring_readback, w, h, app->ring);
+	}
+	if (app->screenshot_requested) {
+		if (!readback_start(app->screenshot_readback, w, h,
+		    app->screenshots)) {
+			fprintf(stderr, "screenshot dropped, still reading "
+			    "earlier ones\n");
+		}
+		app->screenshot_requested = false;
+	}
+}
+
+static void
+publish_frame(uint8_t const *rgba, int width, int height, void *data)
+{
+	ring_publish(data, rgba, width, height);
+}
+
+static void
+save_screenshot(uint8_t const *rgba, int width, int height, void *data)
+{
+	char path[64];
+	screenshot_path(path, sizeof(path), "png");
+	if (!screenshots_save(data, path, rgba, width, height)) {
+		fprintf(stderr, "screenshot dropped, still saving earlier "
+		    "ones\n");
 	}
+}
 
-	return program;
+// Queues the current view to be rendered off-screen at a multiple of the
+// window's size, with the backend and mode that the window uses.
+static void
+render_screenshot(App *app)
+{
+	char path[64];
+	screenshot_path(path, sizeof(path), "png");
+	Canvas c;
+	get_transformation(app, &c.view);
+	c.iterations = app->iterations;
+	c.width = app->window_width * SCREENSHOT_SCALE;
+	c.height = app->window_height * SCREENSHOT_SCALE;
+	c.counts = NULL;
+	bool cpu = app->cpu || app->showing_file;
+	if (!screenshots_render(app->screenshots, path, cpu ? "cpu" : "gpu",
+	    &c, cpu ? app->render_mode : RENDER_MODE_BRUTE)) {
+		fprintf(stderr, "screenshot dropped, still saving earlier "
+		    "ones\n");
+	}
 }
 
-static GLuint
-create_shader(GLenum type, char const *source)
+// Names a file after the current time. Files saved within the same second
+// get a sequence number, which also skips names that are already taken, as
+// earlier ones may still be waiting to be written.
+static void
+screenshot_path(char *path, size_t size, char const *extension)
 {
-	GLuint shader = glCreateShader(type);
-	if (shader == 0) {
-		return 0;
+	static time_t last;
+	static int sequence;
+	time_t now = time(NULL);
+	sequence = now == last ? sequence + 1 : 0;
+	last = now;
+
+	char stamp[32];
+	strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", localtime(&now));
+	for (;; ++sequence) {
+		if (sequence == 0) {
+			snprintf(path, size, "mandelbrot-%s.%s", stamp,
+			    extension);
+		} else {
+			snprintf(path, size, "mandelbrot-%s-%d.%s", stamp,
+			    sequence, extension);
+		}
+		if (!SDL_GetPathInfo(path, NULL)) {
+			return;
+		}
 	}
+}
 
-	glShaderSource(shader, 1, &source, NULL);
-	glCompileShader(shader);
-	GLint status = GL_FALSE;
-	glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
-	if (!status) {
-		glDeleteShader(shader);
-		return 0;
+// Hands on the readbacks that have finished. Returns true if any are still
+// in flight.
+static bool
+poll_readbacks(App *app)
+{
+	bool busy = readback_poll(app->screenshot_readback, save_screenshot,
+	    false);
+	if (app->ring != NULL) {
+		busy |= readback_poll(app->ring_readback, publish_frame,
+		    false);
 	}
+	return busy;
+}
 
-	return shader;
+// Waits for the next event, handing on readbacks that finish in the
+// meantime.
+static void
+wait_event(App *app, SDL_Event *e)
+{
+	while (poll_readbacks(app)) {
+		if (SDL_WaitEventTimeout(e, 1)) {
+			return;
+		}
+	}
+	if (!SDL_WaitEvent(e)) {
+		exit(EXIT_FAILURE);
+	}
 }
 
 static void
 draw(App *app)
 {
-	float t[4];
-	get_transformation(app, t);
+	View t;
+	get_transformation(app, &t);
+
+	double s[4];
+	get_selection(app, &t, s);
 
-	float s[4];
-	get_selection(app, t, s);
+	// Only CPU frames count their costs.
+	hud_set_cost(app->hud, 0, 0);
 
-	glUniform4f(app->transformation_uniform, t[0], t[1], t[2], t[3]);
-	glUniform4f(app->selection_uniform, s[0], s[1], s[2], s[3]);
+	// The image program works in the coordinates of the image, which are
+	// computed here in double precision so that deep views stay aligned.
+	Program *p = &app->mandelbrot_program;
+	if (app->cpu || app->showing_file) {
+		if (!app->showing_file) {
+			request_frame(app, &t);
+			present_frame(app);
+		}
+		if (app->image_width == 0) {
+			glClear(GL_COLOR_BUFFER_BIT);
+			return;
+		}
+		p = &app->image_program;
+
+		View *v = &app->image_view;
+		double center[2] = {t.x, t.y};
+		untransform(v, center);
+		t.x = center[0];
+		t.y = center[1];
+		t.width /= v->width;
+		t.height /= v->height;
+		untransform(v, &s[0]);
+		untransform(v, &s[2]);
+	}
+
+	glUseProgram(p->program);
+	glUniform4f(p->transformation_uniform, t.x, t.y, t.width, t.height);
+	glUniform4f(p->selection_uniform, s[0], s[1], s[2], s[3]);
 	glDrawArrays(GL_TRIANGLES, 0, 6);
 }
 
 static void
-get_transformation(App *app, float *t)
+request_frame(App *app, View const *t)
 {
-	t[0] = app->focus.x;
-	t[1] = app->focus.y;
+	FrameRequest *r = &app->requested;
+	if (r->width == app->window_width &&
+	    r->height == app->window_height &&
+	    r->iterations == app->iterations &&
+	    r->mode == app->render_mode &&
+	    r->heatmap == app->heatmap &&
+	    memcmp(&r->view, t, sizeof(View)) == 0) {
+		return;
+	}
 
-	float window_aspect_ratio =
-	    (float)app->window_width / app->window_height;
-	float focus_aspect_ratio =
-	    app->focus.width / app->focus.height;
+	r->view = *t;
+	r->iterations = app->iterations;
+	r->width = app->window_width;
+	r->height = app->window_height;
+	r->mode = app->render_mode;
+	r->heatmap = app->heatmap;
+	app->generation = renderer_request(app->renderer, r);
+}
 
-	if (window_aspect_ratio >= focus_aspect_ratio) {
-		t[2] = app->focus.height * window_aspect_ratio;
-		t[3] = app->focus.height;
-	} else {
-		t[2] = app->focus.width;
-		t[3] = app->focus.width / window_aspect_ratio;
+// Uploads whatever the render thread has finished since the last frame.
+static void
+present_frame(App *app)
+{
+	Uint64 span = trace_begin();
+	Rect d;
+	Frame const *f = renderer_lock_frame(app->renderer, &d);
+	app->frame_complete = f != NULL && f->complete &&
+	    f->generation == app->generation;
+	if (f != NULL && d.width > 0 && d.height > 0) {
+		Canvas const *c = &f->canvas;
+		if (c->width != app->image_width ||
+		    c->height != app->image_height) {
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, c->width,
+			    c->height, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+			    f->pixels);
+		} else {
+			glPixelStorei(GL_UNPACK_ROW_LENGTH, c->width);
+			glTexSubImage2D(GL_TEXTURE_2D, 0, d.x, d.y, d.width,
+			    d.height, GL_RGBA, GL_UNSIGNED_BYTE,
+			    f->pixels + 4 * ((size_t)d.y * c->width + d.x));
+			glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+		}
+		app->image_view = c->view;
+		app->image_width = c->width;
+		app->image_height = c->height;
+	}
+	if (f != NULL && f->costs != NULL) {
+		hud_set_cost(app->hud, f->cost, f->cost_pixels);
 	}
+	renderer_unlock_frame(app->renderer);
+	trace_end("upload", span);
+}
+
+static void
+get_transformation(App *app, View *t)
+{
+	fit_view(&app->focus, app->window_width, app->window_height, t);
 }
 
 static void
-get_selection(App *app, float const *t, float *s)
+get_selection(App *app, View const *t, double *s)
 {
 	if (app->mouse_mode != MOUSE_MODE_SELECT) {
-		memset(s, 0, 4 * sizeof(float));
+		memset(s, 0, 4 * sizeof(double));
 		return;
 	}
 
@@ -302,11 +980,11 @@ get_selection(App *app, float const *t, float *s)
 	qsort(x, 2, sizeof(int), cmp_int);
 	qsort(y, 2, sizeof(int), cmp_int);
 
-	float w = app->window_width, h = app->window_height;
-	s[0] = 2.f * x[0] / w - 1.f;
-	s[1] = 2.f * y[0] / h - 1.f;
-	s[2] = 2.f * x[1] / w - 1.f;
-	s[3] = 2.f * y[1] / h - 1.f;
+	double w = app->window_width, h = app->window_height;
+	s[0] = 2. * x[0] / w - 1.;
+	s[1] = 2. * y[0] / h - 1.;
+	s[2] = 2. * x[1] / w - 1.;
+	s[3] = 2. * y[1] / h - 1.;
 
 	transform(t, &s[0]);
 	transform(t, &s[2]);
@@ -319,10 +997,17 @@ cmp_int(void const *a, void const *b)
 }
 
 static void
-transform(float const *t, float *p)
+transform(View const *t, double *p)
 {
-	p[0] = t[2] * p[0] + t[0];
-	p[1] = t[3] * p[1] + t[1];
+	p[0] = t->width * p[0] + t->x;
+	p[1] = t->height * p[1] + t->y;
+}
+
+static void
+untransform(View const *t, double *p)
+{
+	p[0] = (p[0] - t->x) / t->width;
+	p[1] = (p[1] - t->y) / t->height;
 }
 
 static void
@@ -330,6 +1015,16 @@ handle_event(App *app, SDL_Event const *e)
 {
 	switch (e->type) {
 	case SDL_EVENT_QUIT:
+		// Readers of the frame ring stop once it is closed, and
+		// screenshots that were asked for are still saved.
+		if (app->ring != NULL) {
+			ring_destroy(app->ring);
+		}
+		readback_poll(app->screenshot_readback, save_screenshot, true);
+		screenshots_destroy(app->screenshots);
+		if (!trace_close()) {
+			fprintf(stderr, "cannot write trace\n");
+		}
 		exit(EXIT_SUCCESS);
 	case SDL_EVENT_WINDOW_PIXEL_SIZE_CHANGED:
 		app->window_width = e->window.data1;
@@ -337,7 +1032,7 @@ handle_event(App *app, SDL_Event const *e)
 		glViewport(0, 0, app->window_width, app->window_height);
 		break;
 	case SDL_EVENT_MOUSE_WHEEL:
-		zoom(app, powf(1.5f, -e->wheel.y));
+		zoom(app, pow(1.5, -e->wheel.y));
 		break;
 	case SDL_EVENT_MOUSE_BUTTON_DOWN:
 		if (app->mouse_mode != MOUSE_MODE_NONE) {
@@ -367,38 +1062,84 @@ handle_event(App *app, SDL_Event const *e)
 		app->mouse_x = e->motion.x;
 		app->mouse_y = e->motion.y;
 		break;
+	case SDL_EVENT_KEY_DOWN:
+		handle_key(app, &e->key);
+		break;
+	}
+}
+
+static void
+handle_key(App *app, SDL_KeyboardEvent const *e)
+{
+	switch (e->key) {
+	case SDLK_G:
+		app->cpu = false;
+		app->showing_file = false;
+		break;
+	case SDLK_B:
+		app->cpu = true;
+		app->showing_file = false;
+		app->render_mode = RENDER_MODE_BRUTE;
+		break;
+	case SDLK_T:
+		app->cpu = true;
+		app->showing_file = false;
+		app->render_mode = RENDER_MODE_TRACE;
+		break;
+	case SDLK_R:
+		app->cpu = true;
+		app->showing_file = false;
+		app->render_mode = RENDER_MODE_GUESS;
+		break;
+	case SDLK_I:
+		save_file(app);
+		break;
+	case SDLK_H:
+		app->show_hud = !app->show_hud;
+		break;
+	case SDLK_C:
+		app->heatmap = !app->heatmap;
+		break;
+	case SDLK_P:
+		if (e->mod & SDL_KMOD_SHIFT) {
+			render_screenshot(app);
+		} else {
+			app->screenshot_requested = true;
+		}
+		break;
 	}
 }
 
 static void
 set_focus_from_selection(App *app)
 {
-	float t[4], s[4];
-	get_transformation(app, t);
-	get_selection(app, t, s);
+	View t;
+	double s[4];
+	get_transformation(app, &t);
+	get_selection(app, &t, s);
 
 	if (s[0] == s[2] || s[1] == s[3]) {
 		return;
 	}
 
-	app->focus.x = (s[0] + s[2]) * .5f;
-	app->focus.y = (s[1] + s[3]) * .5f;
-	app->focus.width = (s[2] - s[0]) * .5f;
-	app->focus.height = (s[3] - s[1]) * .5f;
+	app->focus.x = (s[0] + s[2]) * .5;
+	app->focus.y = (s[1] + s[3]) * .5;
+	app->focus.width = (s[2] - s[0]) * .5;
+	app->focus.height = (s[3] - s[1]) * .5;
 }
 
 static void
-zoom(App *app, float amount)
+zoom(App *app, double amount)
 {
-	float t[4];
-	get_transformation(app, t);
+	View t;
+	get_transformation(app, &t);
 
-	float x = (float)app->mouse_x / app->window_width;
-	float y = 1.f - (float)app->mouse_y / app->window_height;
-	float d[2] = {(2.f * x - 1.f) * t[2], (2.f * y - 1.f) * t[3]};
+	double x = (double)app->mouse_x / app->window_width;
+	double y = 1. - (double)app->mouse_y / app->window_height;
+	double d[2] = {(2. * x - 1.) * t.width, (2. * y - 1.) * t.height};
 
-	app->focus.x += d[0] * (1.f - amount);
-	app->focus.y += d[1] * (1.f - amount);
+	app->focus.x += d[0] * (1. - amount);
+	app->focus.y += d[1] * (1. - amount);
 	app->focus.width *= amount;
 	app->focus.height *= amount;
 }
@@ -406,12 +1147,12 @@ zoom(App *app, float amount)
 static void
 pan(App *app, int x, int y)
 {
-	float t[4];
-	get_transformation(app, t);
+	View t;
+	get_transformation(app, &t);
 
-	float d[2] = {x, -y};
-	d[0] = 2.f * t[2] * d[0] / app->window_width;
-	d[1] = 2.f * t[3] * d[1] / app->window_height;
+	double d[2] = {x, -y};
+	d[0] = 2. * t.width * d[0] / app->window_width;
+	d[1] = 2. * t.height * d[1] / app->window_height;
 
 	app->focus.x -= d[0];
 	app->focus.y -= d[1];
@@ -0,0 +1,383 @@
+// Copyright (c) 2025 Charles Hood <chood@chood.net>
+//
+// This program is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <SDL3/SDL.h>
+#include "backend.h"
+#include "headless.h"
+#include "image.h"
+#include "movie.h"
+#include "pool.h"
+
+typedef struct Movie Movie;
+
+// A frame in the reorder buffer. Frame i uses slot i % slot_count, which is
+// free again once frame i - slot_count has been written.
+typedef struct {
+	Movie *movie;
+	int frame;
+	bool done;
+	Canvas canvas;
+	uint8_t *rgba;
+	uint8_t *yuv;
+} Slot;
+
+struct Movie {
+	RenderOptions options;
+	View from;
+	int frames;
+	SDL_Mutex *mutex;
+	SDL_Condition *done;
+	Slot *slots;
+	int slot_count;
+};
+
+static bool write_frames(Movie *);
+static bool write_keyframed(Movie *, int);
+static void sample_keyframes(Canvas const *, Canvas const *, Canvas *);
+static void render_frame(void *);
+static void usage(void);
+
+// Interpolates between two views at t from 0 to 1. The scale changes
+// exponentially, so that the zoom speed is constant, and the center moves in
+// proportion to the change in scale, so that the point that is zoomed into
+// stays in place on the screen.
+void
+zoom_focus(View const *from, View const *to, double t, View *v)
+{
+	double scale = from->height * pow(to->height / from->height, t);
+	double progress = t;
+	if (from->height != to->height) {
+		progress = (from->height - scale) /
+		    (from->height - to->height);
+	}
+	v->x = from->x + (to->x - from->x) * progress;
+	v->y = from->y + (to->y - from->y) * progress;
+	v->width = v->height = scale;
+}
+
+// Writes a zoom from one view to another to standard output as a Y4M stream,
+// rendering every frame or, with -k, only keyframes.
+int
+movie_main(int argc, char **argv)
+{
+	Movie m;
+	render_options_init(&m.options);
+	m.options.focus.x = -.743643887037151;
+	m.options.focus.y = .131825904205330;
+	m.options.focus.width = m.options.focus.height = 1e-4;
+	m.from.x = -.5;
+	m.from.y = 0.;
+	m.from.width = m.from.height = 1.25;
+	m.frames = 300;
+	int fps = 30, oversampling = 0;
+	bool keyframes = false, backend = false;
+	int c;
+	while ((c = getopt(argc, argv, "O:b:c:f:g:i:km:n:r:s:")) != -1) {
+		switch (c) {
+		case 'O':
+			oversampling = atoi(optarg);
+			if (oversampling <= 0 || oversampling > 8) {
+				usage();
+			}
+			break;
+		case 'f':
+			if (!parse_focus(optarg, &m.from)) {
+				usage();
+			}
+			break;
+		case 'b':
+			backend = true;
+			if (!render_options_parse(&m.options, c, optarg)) {
+				usage();
+			}
+			break;
+		case 'k':
+			keyframes = true;
+			break;
+		case 'n':
+			m.frames = atoi(optarg);
+			if (m.frames <= 0) {
+				usage();
+			}
+			break;
+		case 'r':
+			fps = atoi(optarg);
+			if (fps <= 0) {
+				usage();
+			}
+			break;
+		default:
+			if (!render_options_parse(&m.options, c, optarg)) {
+				usage();
+			}
+		}
+	}
+	// Oversampling and backends only apply to keyframes, so -O or -b
+	// without -k is an error rather than quietly ignored.
+	if (optind != argc || ((oversampling > 0 || backend) && !keyframes)) {
+		usage();
+	}
+	if (keyframes && oversampling == 0) {
+		oversampling = 2;
+	}
+	if (oversampling > 0 && m.from.height < m.options.focus.height) {
+		fprintf(stderr, "mandelbrot: keyframes only work when zooming "
+		    "in\n");
+		return EXIT_FAILURE;
+	}
+	if (isatty(STDOUT_FILENO)) {
+		fprintf(stderr, "mandelbrot: not writing a movie to a "
+		    "terminal\n");
+		return EXIT_FAILURE;
+	}
+
+	if (!y4m_write_header(stdout, m.options.width, m.options.height,
+	    fps)) {
+		exit(EXIT_FAILURE);
+	}
+	Uint64 start = SDL_GetTicksNS();
+	bool ok = oversampling > 0 ? write_keyframed(&m, oversampling) :
+	    write_frames(&m);
+	if (!ok || fflush(stdout) != 0) {
+		fprintf(stderr, "mandelbrot: cannot write frame\n");
+		return EXIT_FAILURE;
+	}
+	double seconds = (SDL_GetTicksNS() - start) / 1e9;
+	fprintf(stderr, "%d frames in %.2f s, %.2f frames/s\n", m.frames,
+	    seconds, m.frames / seconds);
+	return EXIT_SUCCESS;
+}
+
+// Renders frames in parallel, one per thread, and writes them in order
+// through a reorder buffer of twice as many frames as there are threads.
+static bool
+write_frames(Movie *m)
+{
+	Pool *pool = pool_create(0);
+	m->mutex = SDL_CreateMutex();
+	m->done = SDL_CreateCondition();
+	if (pool == NULL || m->mutex == NULL || m->done == NULL) {
+		exit(EXIT_FAILURE);
+	}
+	m->slot_count = SDL_min(2 * pool_size(pool), m->frames);
+	m->slots = calloc(m->slot_count, sizeof(Slot));
+	if (m->slots == NULL) {
+		exit(EXIT_FAILURE);
+	}
+	int width = m->options.width, height = m->options.height;
+	for (int i = 0; i < m->slot_count; ++i) {
+		Slot *s = &m->slots[i];
+		s->movie = m;
+		s->rgba = malloc((size_t)width * height * 4);
+		s->yuv = malloc((size_t)width * height * 3);
+		if (s->rgba == NULL || s->yuv == NULL ||
+		    !canvas_init(&s->canvas, &m->options.focus,
+		    m->options.iterations, width, height)) {
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	bool ok = true;
+	int submitted = 0;
+	for (int written = 0; written < m->frames && ok; ++written) {
+		for (; submitted < m->frames &&
+		    submitted < written + m->slot_count; ++submitted) {
+			Slot *s = &m->slots[submitted % m->slot_count];
+			s->frame = submitted;
+			s->done = false;
+			pool_submit(pool, render_frame, s);
+		}
+
+		Slot *s = &m->slots[written % m->slot_count];
+		SDL_LockMutex(m->mutex);
+		while (!s->done) {
+			SDL_WaitCondition(m->done, m->mutex);
+		}
+		SDL_UnlockMutex(m->mutex);
+		ok = y4m_write_frame(stdout, s->yuv, width, height);
+	}
+
+	pool_destroy(pool);
+	for (int i = 0; i < m->slot_count; ++i) {
+		canvas_free(&m->slots[i].canvas);
+		free(m->slots[i].rgba);
+		free(m->slots[i].yuv);
+	}
+	free(m->slots);
+	SDL_DestroyCondition(m->done);
+	SDL_DestroyMutex(m->mutex);
+	return ok;
+}
+
+// Renders a keyframe at every halving of the scale, oversampled in both
+// directions, and draws the frames in between from the two keyframes around
+// them. The next keyframe is rendered while the frames before it are drawn.
+static bool
+write_keyframed(Movie *m, int oversampling)
+{
+	Backend *b = backend_create(m->options.backend);
+	if (b == NULL) {
+		fprintf(stderr, "%s: backend is unknown or unavailable\n",
+		    m->options.backend);
+		exit(EXIT_FAILURE);
+	}
+	int width = m->options.width, height = m->options.height;
+	double ratio = m->from.height / m->options.focus.height;
+	int keyframe_count = 1 + (ratio > 1. ? (int)ceil(log2(ratio)) : 0);
+
+	Canvas keyframes[3], frame;
+	uint8_t *rgba = malloc((size_t)width * height * 4);
+	uint8_t *yuv = malloc((size_t)width * height * 3);
+	if (rgba == NULL || yuv == NULL || !canvas_init(&frame,
+	    &m->options.focus, m->options.iterations, width, height)) {
+		exit(EXIT_FAILURE);
+	}
+	for (int i = 0; i < 3; ++i) {
+		if (!canvas_init(&keyframes[i], &m->options.focus,
+		    m->options.iterations, width * oversampling,
+		    height * oversampling)) {
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	bool ok = true;
+	int ready = 0, pending = -1;
+	for (int i = 0; i < m->frames && ok; ++i) {
+		double t = m->frames > 1 ? (double)i / (m->frames - 1) : 0.;
+		View focus;
+		zoom_focus(&m->from, &m->options.focus, t, &focus);
+		int k = SDL_max(0, (int)floor(log2(m->from.height /
+		    focus.height)));
+		k = SDL_min(k, keyframe_count - 2);
+		int next = SDL_min(k + 1, keyframe_count - 1);
+
+		// Keyframe j goes into slot j % 3, whose previous keyframe is
+		// no longer needed once the frames reach keyframe j - 2.
+		while (ready <= next || (pending == -1 &&
+		    ready < keyframe_count && ready <= k + 2)) {
+			if (pending != -1) {
+				ok = backend_wait(b) && ok;
+				pending = -1;
+				++ready;
+				continue;
+			}
+			pending = ready;
+			Canvas *c = &keyframes[pending % 3];
+			View v;
+			double scale = SDL_max(ldexp(m->from.height,
+			    -pending), m->options.focus.height);
+			zoom_focus(&m->from, &m->options.focus,
+			    ratio > 1. ? log(m->from.height / scale) /
+			    log(ratio) : 0., &v);
+			fit_view(&v, c->width, c->height, &c->view);
+			if (!backend_start(b, c, m->options.mode)) {
+				exit(EXIT_FAILURE);
+			}
+		}
+
+		fit_view(&focus, width, height, &frame.view);
+		sample_keyframes(&keyframes[SDL_max(k, 0) % 3],
+		    &keyframes[next % 3], &frame);
+		Rect all = {0, 0, width, height};
+		colorize(&frame, &all, rgba);
+		rgba_to_yuv(rgba, width, height, yuv);
+		ok = y4m_write_frame(stdout, yuv, width, height) && ok;
+	}
+	if (pending != -1) {
+		backend_wait(b);
+	}
+	fprintf(stderr, "%d keyframes of %dx%d\n", keyframe_count,
+	    width * oversampling, height * oversampling);
+
+	backend_destroy(b);
+	for (int i = 0; i < 3; ++i) {
+		canvas_free(&keyframes[i]);
+	}
+	canvas_free(&frame);
+	free(rgba);
+	free(yuv);
+	return ok;
+}
+
+// Takes every pixel of a frame from the nearest pixel of the inner keyframe
+// where it covers the frame and from the outer one elsewhere.
+static void
+sample_keyframes(Canvas const *outer, Canvas const *inner, Canvas *frame)
+{
+	for (int y = 0; y < frame->height; ++y) {
+		uint32_t *row = frame->counts + (size_t)y * frame->width;
+		for (int x = 0; x < frame->width; ++x) {
+			double p[2];
+			canvas_point(frame, x, y, p);
+			Canvas const *c = inner;
+			double fx = ((p[0] - c->view.x) / c->view.width + 1.) *
+			    .5 * c->width;
+			double fy = (1. - (p[1] - c->view.y) / c->view.height) *
+			    .5 * c->height;
+			if (fx < 0. || fx >= c->width || fy < 0. ||
+			    fy >= c->height) {
+				c = outer;
+				fx = ((p[0] - c->view.x) / c->view.width +
+				    1.) * .5 * c->width;
+				fy = (1. - (p[1] - c->view.y) /
+				    c->view.height) * .5 * c->height;
+				fx = SDL_clamp(fx, 0., c->width - 1.);
+				fy = SDL_clamp(fy, 0., c->height - 1.);
+			}
+			row[x] = c->counts[(size_t)fy * c->width + (size_t)fx];
+		}
+	}
+}
+
+static void
+render_frame(void *data)
+{
+	Slot *s = data;
+	Movie *m = s->movie;
+	Canvas *c = &s->canvas;
+
+	View focus;
+	double t = m->frames > 1 ? (double)s->frame / (m->frames - 1) : 0.;
+	zoom_focus(&m->from, &m->options.focus, t, &focus);
+	fit_view(&focus, c->width, c->height, &c->view);
+
+	Rect all = {0, 0, c->width, c->height};
+	render(c, &all, m->options.mode, NULL);
+	colorize(c, &all, s->rgba);
+	rgba_to_yuv(s->rgba, c->width, c->height, s->yuv);
+
+	SDL_LockMutex(m->mutex);
+	s->done = true;
+	SDL_BroadcastCondition(m->done);
+	SDL_UnlockMutex(m->mutex);
+}
+
+static void
+usage(void)
+{
+	fprintf(stderr, "usage: mandelbrot movie [-f x,y,scale] [-c x,y] "
+	    "[-s scale] [-n frames] [-r fps]\n"
+	    "                        [-g WIDTHxHEIGHT] [-i iterations] "
+	    "[-m brute|trace|guess]\n"
+	    "                        [-k [-O oversampling] [-b cpu|gpu]] "
+	    "> file.y4m\n");
+	exit(EXIT_FAILURE);
+}
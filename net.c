@@ -0,0 +1,173 @@
+// Copyright (c) 2025 Charles Hood <chood@chood.net>
+//
+// This program is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "net.h"
+
+#define NET_BACKLOG 64
+
+static int open_address(char const *, bool);
+static int open_unix(char const *, bool);
+static int open_tcp(char const *, bool);
+
+// Addresses that contain a slash are paths of Unix sockets, and any other
+// address is "host:port" for TCP. A listening Unix socket replaces a socket
+// left at its path, but not any other kind of file. Returns -1 on failure.
+int
+net_listen(char const *address)
+{
+	return open_address(address, true);
+}
+
+int
+net_connect(char const *address)
+{
+	return open_address(address, false);
+}
+
+// Reads exactly the given number of bytes, returning false at the end of
+// the stream or on an error.
+bool
+net_read(int fd, void *buffer, size_t length)
+{
+	for (size_t n = 0; n < length;) {
+		ssize_t r = recv(fd, (char *)buffer + n, length - n, 0);
+		if (r == 0 || (r < 0 && errno != EINTR)) {
+			return false;
+		}
+		n += r > 0 ? r : 0;
+	}
+	return true;
+}
+
+// Writes everything or returns false. A closed peer is reported as an error
+// rather than raising SIGPIPE.
+bool
+net_write(int fd, void const *buffer, size_t length)
+{
+	for (size_t n = 0; n < length;) {
+		ssize_t r = send(fd, (char const *)buffer + n, length - n,
+		    MSG_NOSIGNAL);
+		if (r < 0 && errno != EINTR) {
+			return false;
+		}
+		n += r > 0 ? r : 0;
+	}
+	return true;
+}
+
+static int
+open_address(char const *address, bool listening)
+{
+	if (strchr(address, '/') != NULL) {
+		return open_unix(address, listening);
+	}
+	return open_tcp(address, listening);
+}
+
+static int
+open_unix(char const *path, bool listening)
+{
+	struct sockaddr_un a;
+	memset(&a, 0, sizeof(a));
+	a.sun_family = AF_UNIX;
+	if (strlen(path) >= sizeof(a.sun_path)) {
+		return -1;
+	}
+	strcpy(a.sun_path, path);
+
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd == -1) {
+		return -1;
+	}
+	if (listening) {
+		struct stat st;
+		if (lstat(path, &st) == 0 && S_ISSOCK(st.st_mode)) {
+			unlink(path);
+		}
+		if (bind(fd, (struct sockaddr *)&a, sizeof(a)) == 0 &&
+		    listen(fd, NET_BACKLOG) == 0) {
+			return fd;
+		}
+	} else if (connect(fd, (struct sockaddr *)&a, sizeof(a)) == 0) {
+		return fd;
+	}
+	close(fd);
+	return -1;
+}
+
+// An empty host listens on every interface.
+static int
+open_tcp(char const *address, bool listening)
+{
+	char const *colon = strrchr(address, ':');
+	if (colon == NULL) {
+		return -1;
+	}
+	char *host = strndup(address, colon - address);
+	if (host == NULL) {
+		return -1;
+	}
+
+	struct addrinfo hints, *list;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_flags = listening ? AI_PASSIVE : 0;
+	int error = getaddrinfo(*host != '\0' ? host : NULL, colon + 1,
+	    &hints, &list);
+	free(host);
+	if (error != 0) {
+		return -1;
+	}
+
+	int fd = -1;
+	for (struct addrinfo *a = list; a != NULL && fd == -1;
+	    a = a->ai_next) {
+		fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+		if (fd == -1) {
+			continue;
+		}
+		int one = 1;
+		bool ok;
+		if (listening) {
+			setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one,
+			    sizeof(one));
+			ok = bind(fd, a->ai_addr, a->ai_addrlen) == 0 &&
+			    listen(fd, NET_BACKLOG) == 0;
+		} else {
+			ok = connect(fd, a->ai_addr, a->ai_addrlen) == 0;
+		}
+		// Accepted sockets inherit this from the listening one.
+		setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+		if (!ok) {
+			close(fd);
+			fd = -1;
+		}
+	}
+	freeaddrinfo(list);
+	return fd;
+}
@@ -0,0 +1,172 @@
+// Copyright (c) 2025 Charles Hood <chood@chood.net>
+//
+// This program is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+
+#include <stdlib.h>
+#include <SDL3/SDL.h>
+#include "pool.h"
+#include "trace.h"
+
+typedef struct Task Task;
+struct Task {
+	PoolTask *function;
+	void *data;
+	Task *next;
+};
+
+struct Pool {
+	SDL_Mutex *mutex;
+	SDL_Condition *work;
+	SDL_Condition *idle;
+	Task *head;
+	Task *tail;
+	int active;
+	bool quit;
+	int thread_count;
+	SDL_Thread **threads;
+};
+
+static int run_worker(void *);
+
+// A pool with a thread count of zero or less gets one thread per logical
+// core.
+Pool *
+pool_create(int thread_count)
+{
+	if (thread_count <= 0) {
+		thread_count = SDL_GetNumLogicalCPUCores();
+	}
+
+	Pool *pool = calloc(1, sizeof(Pool));
+	if (pool == NULL) {
+		return NULL;
+	}
+	pool->mutex = SDL_CreateMutex();
+	pool->work = SDL_CreateCondition();
+	pool->idle = SDL_CreateCondition();
+	pool->threads = calloc(thread_count, sizeof(SDL_Thread *));
+	if (pool->mutex == NULL || pool->work == NULL || pool->idle == NULL ||
+	    pool->threads == NULL) {
+		pool_destroy(pool);
+		return NULL;
+	}
+
+	for (int i = 0; i < thread_count; ++i) {
+		pool->threads[i] = SDL_CreateThread(run_worker, "worker",
+		    pool);
+		if (pool->threads[i] == NULL) {
+			pool_destroy(pool);
+			return NULL;
+		}
+		++pool->thread_count;
+	}
+	return pool;
+}
+
+// Waits for queued tasks to finish before stopping the threads.
+void
+pool_destroy(Pool *pool)
+{
+	if (pool->mutex != NULL) {
+		pool_wait(pool);
+		SDL_LockMutex(pool->mutex);
+		pool->quit = true;
+		SDL_BroadcastCondition(pool->work);
+		SDL_UnlockMutex(pool->mutex);
+	}
+	for (int i = 0; i < pool->thread_count; ++i) {
+		SDL_WaitThread(pool->threads[i], NULL);
+	}
+
+	free(pool->threads);
+	SDL_DestroyCondition(pool->idle);
+	SDL_DestroyCondition(pool->work);
+	SDL_DestroyMutex(pool->mutex);
+	free(pool);
+}
+
+int
+pool_size(Pool const *pool)
+{
+	return pool->thread_count;
+}
+
+void
+pool_submit(Pool *pool, PoolTask *function, void *data)
+{
+	Task *task = malloc(sizeof(Task));
+	if (task == NULL) {
+		function(data);
+		return;
+	}
+	task->function = function;
+	task->data = data;
+	task->next = NULL;
+
+	SDL_LockMutex(pool->mutex);
+	if (pool->tail == NULL) {
+		pool->head = task;
+	} else {
+		pool->tail->next = task;
+	}
+	pool->tail = task;
+	SDL_SignalCondition(pool->work);
+	SDL_UnlockMutex(pool->mutex);
+}
+
+// Blocks until the queue is empty and no task is running.
+void
+pool_wait(Pool *pool)
+{
+	SDL_LockMutex(pool->mutex);
+	while (pool->head != NULL || pool->active > 0) {
+		SDL_WaitCondition(pool->idle, pool->mutex);
+	}
+	SDL_UnlockMutex(pool->mutex);
+}
+
+static int
+run_worker(void *data)
+{
+	Pool *pool = data;
+	trace_thread("worker");
+
+	SDL_LockMutex(pool->mutex);
+	for (;;) {
+		while (pool->head == NULL && !pool->quit) {
+			SDL_WaitCondition(pool->work, pool->mutex);
+		}
+		if (pool->head == NULL) {
+			break;
+		}
+
+		Task *task = pool->head;
+		pool->head = task->next;
+		if (pool->head == NULL) {
+			pool->tail = NULL;
+		}
+		++pool->active;
+		SDL_UnlockMutex(pool->mutex);
+
+		task->function(task->data);
+		free(task);
+
+		SDL_LockMutex(pool->mutex);
+		if (--pool->active == 0 && pool->head == NULL) {
+			SDL_BroadcastCondition(pool->idle);
+		}
+	}
+	SDL_UnlockMutex(pool->mutex);
+	return 0;
+}
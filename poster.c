@@ -0,0 +1,185 @@
+// Copyright (c) 2025 Charles Hood <chood@chood.net>
+//
+// This program is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#include <SDL3/SDL.h>
+#include "backend.h"
+#include "checkpoint.h"
+#include "headless.h"
+#include "image.h"
+#include "poster.h"
+
+static void set_band(Canvas *, View const *, int, int, int);
+static void usage(void);
+
+// Renders an image of any size in bands of rows and writes each band as soon
+// as it is done, so that memory use depends on the width and the band height
+// but not on the height of the image. The next band is rendered while the
+// previous one is colorized and encoded.
+//
+// With a checkpoint, finished bands are also saved to a file from which an
+// interrupted render can be resumed. Resuming still writes the whole image,
+// but bands found in the checkpoint are read back instead of rendered.
+int
+poster_main(int argc, char **argv)
+{
+	RenderOptions o;
+	render_options_init(&o);
+	int band_height = 128;
+	char const *checkpoint_path = NULL;
+	bool resume = false;
+	int c;
+	while ((c = getopt(argc, argv, RENDER_OPTIONS "C:Rr:")) != -1) {
+		if (c == 'C') {
+			checkpoint_path = optarg;
+		} else if (c == 'R') {
+			resume = true;
+		} else if (c == 'r') {
+			band_height = atoi(optarg);
+			if (band_height <= 0) {
+				usage();
+			}
+		} else if (!render_options_parse(&o, c, optarg)) {
+			usage();
+		}
+	}
+	if (o.path == NULL || optind != argc ||
+	    (resume && checkpoint_path == NULL)) {
+		usage();
+	}
+	band_height = SDL_min(band_height, o.height);
+
+	Checkpoint *k = NULL;
+	if (checkpoint_path != NULL) {
+		k = checkpoint_open(checkpoint_path, &o, band_height, resume);
+		if (k == NULL) {
+			fprintf(stderr, "%s: cannot %s checkpoint\n",
+			    checkpoint_path, resume ? "resume from" :
+			    "create");
+			return EXIT_FAILURE;
+		}
+	}
+
+	Backend *b = backend_create(o.backend);
+	if (b == NULL) {
+		fprintf(stderr, "%s: backend is unknown or unavailable\n",
+		    o.backend);
+		return EXIT_FAILURE;
+	}
+	ImageWriter *w = image_create(o.path, o.width, o.height);
+	if (w == NULL) {
+		fprintf(stderr, "%s: cannot create image\n", o.path);
+		return EXIT_FAILURE;
+	}
+
+	View view;
+	render_options_view(&o, &view);
+	Canvas bands[2];
+	uint8_t *pixels = malloc((size_t)o.width * band_height * 4);
+	if (pixels == NULL || !canvas_init(&bands[0], &view, o.iterations,
+	    o.width, band_height) || !canvas_init(&bands[1], &view,
+	    o.iterations, o.width, band_height)) {
+		exit(EXIT_FAILURE);
+	}
+
+	Uint64 start = SDL_GetTicksNS();
+	int count = (o.height + band_height - 1) / band_height;
+	if (k != NULL && resume) {
+		fprintf(stderr, "resuming with %d of %d bands finished\n",
+		    checkpoint_count(k), count);
+	}
+	for (int i = 0; i <= count; ++i) {
+		Canvas *next = &bands[i % 2], *done = &bands[(i + 1) % 2];
+		bool loaded = false;
+		if (i < count) {
+			set_band(next, &view, o.height, i * band_height,
+			    SDL_min(band_height, o.height - i * band_height));
+			loaded = k != NULL && checkpoint_load(k, i, next);
+			if (!loaded && !backend_start(b, next, o.mode)) {
+				exit(EXIT_FAILURE);
+			}
+		}
+		if (i > 0) {
+			Rect all = {0, 0, done->width, done->height};
+			colorize(done, &all, pixels);
+			if (!image_write(w, pixels, done->height)) {
+				fprintf(stderr, "%s: cannot write image\n",
+				    o.path);
+				return EXIT_FAILURE;
+			}
+		}
+		if (i < count && !loaded) {
+			if (!backend_wait(b)) {
+				fprintf(stderr, "%s: render failed\n",
+				    backend_name(b));
+				return EXIT_FAILURE;
+			}
+			if (k != NULL) {
+				checkpoint_save(k, i, next);
+			}
+		}
+	}
+	if (!image_close(w)) {
+		fprintf(stderr, "%s: cannot write image\n", o.path);
+		return EXIT_FAILURE;
+	}
+	if (k != NULL && !checkpoint_close(k)) {
+		fprintf(stderr, "%s: cannot write checkpoint\n",
+		    checkpoint_path);
+	}
+	double seconds = (SDL_GetTicksNS() - start) / 1e9;
+
+	canvas_free(&bands[0]);
+	canvas_free(&bands[1]);
+	free(pixels);
+	backend_destroy(b);
+
+	// ru_maxrss is in kilobytes on Linux and the BSDs.
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	double megapixels = (double)o.width * o.height / 1e6;
+	fprintf(stderr, "%.1f megapixels in %.2f s, %.2f megapixels/s, "
+	    "peak RSS %.1f MiB\n", megapixels, seconds, megapixels / seconds,
+	    usage.ru_maxrss / 1024.);
+	return EXIT_SUCCESS;
+}
+
+// Points a band canvas at rows y to y + height of an image of a view.
+static void
+set_band(Canvas *c, View const *view, int image_height, int y, int height)
+{
+	c->view.x = view->x;
+	c->view.width = view->width;
+	c->view.y = view->y + view->height *
+	    (1. - (2. * y + height) / image_height);
+	c->view.height = view->height * height / image_height;
+	c->height = height;
+}
+
+static void
+usage(void)
+{
+	fprintf(stderr, "usage: mandelbrot poster [-b cpu|gpu] [-c x,y] "
+	    "[-s scale] [-g WIDTHxHEIGHT]\n"
+	    "                         [-i iterations] "
+	    "[-m brute|trace|guess] [-r band-rows]\n"
+	    "                         [-C checkpoint [-R]] -o file\n");
+	exit(EXIT_FAILURE);
+}
@@ -0,0 +1,408 @@
+// Copyright (c) 2025 Charles Hood <chood@chood.net>
+//
+// This program is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <SDL3/SDL.h>
+#include "headless.h"
+#include "image.h"
+#include "pool.h"
+#include "pyramid.h"
+
+#define PYRAMID_TILE_SIZE 256
+#define PYRAMID_TILE_SHIFT 8
+#define PYRAMID_TILE_BYTES (PYRAMID_TILE_SIZE * PYRAMID_TILE_SIZE * 4)
+
+typedef enum {
+	PYRAMID_XYZ,
+	PYRAMID_DZI,
+} PyramidFormat;
+
+// A square region cut into 2^z by 2^z tiles at each level z from min_level to
+// max_level. Tiles of the deepest level are rendered and the others are
+// downsampled from their four children.
+typedef struct {
+	View region;
+	int iterations;
+	RenderMode mode;
+	PyramidFormat format;
+	char const *path;
+	size_t path_length;
+	int min_level;
+	int max_level;
+	SDL_AtomicInt rendered;
+	SDL_AtomicInt downsampled;
+	SDL_AtomicInt skipped;
+	SDL_AtomicInt failed;
+} Pyramid;
+
+typedef struct {
+	Pyramid *pyramid;
+	int level;
+	int64_t x;
+	int64_t y;
+} Job;
+
+static void run_job(void *);
+static bool build_tile(Pyramid *, int, int64_t, int64_t, uint8_t *);
+static bool render_tile(Pyramid *, int, int64_t, int64_t, uint8_t *);
+static bool write_tile(char const *, int, int, uint8_t const *);
+static void tile_path(Pyramid const *, int, int64_t, int64_t, char *);
+static void downsample(uint8_t const *, int, int, uint8_t *, int);
+static bool make_parents(char *);
+static bool write_dzi(Pyramid *);
+static bool parse_levels(char const *, int *, int *);
+static void usage(void);
+
+// Writes a pyramid of PNG tiles for web viewers, either as z/x/y.png in a
+// directory or as a Deep Zoom image. Tiles that already exist are kept, so an
+// interrupted export can be resumed by running it again.
+int
+pyramid_main(int argc, char **argv)
+{
+	RenderOptions o;
+	render_options_init(&o);
+	Pyramid p;
+	p.format = PYRAMID_XYZ;
+	p.min_level = 0;
+	p.max_level = 4;
+	int c;
+	while ((c = getopt(argc, argv, "c:f:i:m:o:s:z:")) != -1) {
+		switch (c) {
+		case 'f':
+			if (strcmp(optarg, "xyz") == 0) {
+				p.format = PYRAMID_XYZ;
+			} else if (strcmp(optarg, "dzi") == 0) {
+				p.format = PYRAMID_DZI;
+			} else {
+				usage();
+			}
+			break;
+		case 'z':
+			if (!parse_levels(optarg, &p.min_level,
+			    &p.max_level)) {
+				usage();
+			}
+			break;
+		default:
+			if (!render_options_parse(&o, c, optarg)) {
+				usage();
+			}
+		}
+	}
+	if (o.path == NULL || optind != argc) {
+		usage();
+	}
+
+	p.region = o.focus;
+	p.iterations = o.iterations;
+	p.mode = o.mode;
+	p.path = o.path;
+	p.path_length = strlen(o.path);
+	if (p.format == PYRAMID_DZI) {
+		if (p.path_length < 4 ||
+		    strcmp(o.path + p.path_length - 4, ".dzi") != 0) {
+			fprintf(stderr, "%s: Deep Zoom images must end in "
+			    ".dzi\n", o.path);
+			return EXIT_FAILURE;
+		}
+		if (p.min_level != 0) {
+			fprintf(stderr, "%s: Deep Zoom images need every "
+			    "level, so -z has to start at 0\n", o.path);
+			return EXIT_FAILURE;
+		}
+		p.path_length -= 4;
+	}
+	SDL_SetAtomicInt(&p.rendered, 0);
+	SDL_SetAtomicInt(&p.downsampled, 0);
+	SDL_SetAtomicInt(&p.skipped, 0);
+	SDL_SetAtomicInt(&p.failed, 0);
+
+	Pool *pool = pool_create(0);
+	if (pool == NULL) {
+		exit(EXIT_FAILURE);
+	}
+
+	// Each subtree below the split level is built depth first by one
+	// thread, which keeps only a few tiles per level in memory. There are
+	// enough of them to keep every thread busy. The levels above it are
+	// built level by level from the tiles on disk.
+	int split = p.min_level;
+	while (split < p.max_level &&
+	    (int64_t)1 << 2 * split < 4 * pool_size(pool)) {
+		++split;
+	}
+	for (int level = split; level >= p.min_level; --level) {
+		int64_t n = (int64_t)1 << level;
+		Job *jobs = malloc(n * n * sizeof(Job));
+		if (jobs == NULL) {
+			exit(EXIT_FAILURE);
+		}
+		for (int64_t i = 0; i < n * n; ++i) {
+			jobs[i].pyramid = &p;
+			jobs[i].level = level;
+			jobs[i].x = i % n;
+			jobs[i].y = i / n;
+			pool_submit(pool, run_job, &jobs[i]);
+		}
+		pool_wait(pool);
+		free(jobs);
+	}
+	pool_destroy(pool);
+
+	if (p.format == PYRAMID_DZI && !write_dzi(&p)) {
+		SDL_AddAtomicInt(&p.failed, 1);
+	}
+
+	fprintf(stderr, "%d tiles rendered, %d downsampled, %d kept\n",
+	    SDL_GetAtomicInt(&p.rendered), SDL_GetAtomicInt(&p.downsampled),
+	    SDL_GetAtomicInt(&p.skipped));
+	if (SDL_GetAtomicInt(&p.failed) > 0) {
+		fprintf(stderr, "%s: %d tiles could not be written\n", o.path,
+		    SDL_GetAtomicInt(&p.failed));
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
+
+static void
+run_job(void *data)
+{
+	Job *j = data;
+	if (!build_tile(j->pyramid, j->level, j->x, j->y, NULL)) {
+		SDL_AddAtomicInt(&j->pyramid->failed, 1);
+	}
+}
+
+// Makes sure that a tile and everything below it exist on disk, and reads it
+// into rgba if that is not NULL. Tiles are written after their children, so
+// a tile that exists has a complete subtree.
+static bool
+build_tile(Pyramid *p, int level, int64_t x, int64_t y, uint8_t *rgba)
+{
+	char *path = malloc(p->path_length + 64);
+	if (path == NULL) {
+		return false;
+	}
+	tile_path(p, level, x, y, path);
+	if (access(path, F_OK) == 0 && (rgba == NULL ||
+	    image_read(path, PYRAMID_TILE_SIZE, PYRAMID_TILE_SIZE, rgba))) {
+		if (rgba == NULL) {
+			SDL_AddAtomicInt(&p->skipped, 1);
+		}
+		free(path);
+		return true;
+	}
+
+	uint8_t *tile = rgba != NULL ? rgba : malloc(PYRAMID_TILE_BYTES);
+	uint8_t *child = malloc(PYRAMID_TILE_BYTES);
+	bool ok = tile != NULL && child != NULL;
+	if (ok && level == p->max_level) {
+		ok = render_tile(p, level, x, y, tile);
+		SDL_AddAtomicInt(&p->rendered, 1);
+	} else if (ok) {
+		int half = PYRAMID_TILE_SIZE / 2;
+		for (int i = 0; i < 4 && ok; ++i) {
+			ok = build_tile(p, level + 1, 2 * x + i % 2,
+			    2 * y + i / 2, child);
+			downsample(child, PYRAMID_TILE_SIZE, PYRAMID_TILE_SIZE,
+			    tile + 4 * ((size_t)i / 2 * half *
+			    PYRAMID_TILE_SIZE + i % 2 * half),
+			    PYRAMID_TILE_SIZE);
+		}
+		SDL_AddAtomicInt(&p->downsampled, 1);
+	}
+	ok = ok && write_tile(path, PYRAMID_TILE_SIZE, PYRAMID_TILE_SIZE,
+	    tile);
+
+	if (tile != rgba) {
+		free(tile);
+	}
+	free(child);
+	free(path);
+	return ok;
+}
+
+static bool
+render_tile(Pyramid *p, int level, int64_t x, int64_t y, uint8_t *rgba)
+{
+	double half = ldexp(p->region.height, -level);
+	View v = {
+		p->region.x - p->region.height + (2 * x + 1) * half,
+		p->region.y + p->region.height - (2 * y + 1) * half,
+		half,
+		half,
+	};
+	Canvas c;
+	if (!canvas_init(&c, &v, p->iterations, PYRAMID_TILE_SIZE,
+	    PYRAMID_TILE_SIZE)) {
+		return false;
+	}
+	Rect all = {0, 0, PYRAMID_TILE_SIZE, PYRAMID_TILE_SIZE};
+	render(&c, &all, p->mode, NULL);
+	colorize(&c, &all, rgba);
+	canvas_free(&c);
+	return true;
+}
+
+// Writes to a temporary file first so that an interrupted export never
+// leaves a partial tile behind. Paths end in .png, which the temporary file
+// keeps so that it is written in the same format.
+static bool
+write_tile(char const *path, int width, int height, uint8_t const *rgba)
+{
+	size_t n = strlen(path) - 4;
+	char *temporary = malloc(n + 9);
+	if (temporary == NULL) {
+		return false;
+	}
+	memcpy(temporary, path, n);
+	memcpy(temporary + n, ".tmp.png", 9);
+
+	bool ok = make_parents(temporary);
+	ImageWriter *w = ok ? image_create(temporary, width, height) : NULL;
+	if (w != NULL) {
+		ok = image_write(w, rgba, height);
+		ok = image_close(w) && ok;
+		ok = ok && rename(temporary, path) == 0;
+	} else {
+		ok = false;
+	}
+	if (!ok) {
+		remove(temporary);
+	}
+	free(temporary);
+	return ok;
+}
+
+static void
+tile_path(Pyramid const *p, int level, int64_t x, int64_t y, char *path)
+{
+	if (p->format == PYRAMID_DZI) {
+		sprintf(path, "%.*s_files/%d/%" PRId64 "_%" PRId64 ".png",
+		    (int)p->path_length, p->path,
+		    level + PYRAMID_TILE_SHIFT, x, y);
+	} else {
+		sprintf(path, "%s/%d/%" PRId64 "/%" PRId64 ".png", p->path,
+		    level, x, y);
+	}
+}
+
+// Halves an RGBA image by averaging blocks of 2x2 pixels, writing rows of
+// stride pixels.
+static void
+downsample(uint8_t const *from, int width, int height, uint8_t *to,
+    int stride)
+{
+	for (int y = 0; y < height / 2; ++y) {
+		uint8_t const *a = from + (size_t)8 * y * width;
+		uint8_t const *b = a + (size_t)4 * width;
+		uint8_t *row = to + (size_t)4 * y * stride;
+		for (int x = 0; x < 4 * (width / 2); ++x) {
+			int i = x / 4 * 8 + x % 4;
+			row[x] = (a[i] + a[i + 4] + b[i] + b[i + 4] + 2) / 4;
+		}
+	}
+}
+
+// Creates the directories leading up to a path.
+static bool
+make_parents(char *path)
+{
+	for (char *s = strchr(path + 1, '/'); s != NULL;
+	    s = strchr(s + 1, '/')) {
+		*s = '\0';
+		bool ok = mkdir(path, 0777) == 0 || errno == EEXIST;
+		*s = '/';
+		if (!ok) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// Writes the descriptor and the levels smaller than a tile, as Deep Zoom
+// viewers expect every level. The pyramid starts with a single tile.
+static bool
+write_dzi(Pyramid *p)
+{
+	uint8_t *tile = malloc(PYRAMID_TILE_BYTES);
+	char *path = malloc(p->path_length + 64);
+	bool ok = tile != NULL && path != NULL;
+	if (ok) {
+		tile_path(p, 0, 0, 0, path);
+		ok = image_read(path, PYRAMID_TILE_SIZE, PYRAMID_TILE_SIZE,
+		    tile);
+	}
+	for (int size = PYRAMID_TILE_SIZE / 2; ok && size > 0; size /= 2) {
+		downsample(tile, 2 * size, 2 * size, tile, size);
+		tile_path(p, (int)log2(size) - PYRAMID_TILE_SHIFT, 0, 0, path);
+		ok = write_tile(path, size, size, tile);
+	}
+	free(tile);
+	free(path);
+	if (!ok) {
+		return false;
+	}
+
+	FILE *f = fopen(p->path, "w");
+	if (f == NULL) {
+		return false;
+	}
+	int64_t size = (int64_t)PYRAMID_TILE_SIZE << p->max_level;
+	fprintf(f, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+	    "<Image xmlns=\"http://schemas.microsoft.com/deepzoom/2008\"\n"
+	    "  Format=\"png\" Overlap=\"0\" TileSize=\"%d\">\n"
+	    "  <Size Width=\"%" PRId64 "\" Height=\"%" PRId64 "\"/>\n"
+	    "</Image>\n", PYRAMID_TILE_SIZE, size, size);
+	return fclose(f) == 0;
+}
+
+// Parses the levels of a pyramid written as "min,max".
+static bool
+parse_levels(char const *s, int *min, int *max)
+{
+	char *end;
+	long a = strtol(s, &end, 10);
+	if (end == s || *end != ',') {
+		return false;
+	}
+	s = end + 1;
+	long b = strtol(s, &end, 10);
+	if (end == s || *end != '\0' || a < 0 || b < a || b > 30) {
+		return false;
+	}
+	*min = a;
+	*max = b;
+	return true;
+}
+
+static void
+usage(void)
+{
+	fprintf(stderr, "usage: mandelbrot pyramid [-f xyz|dzi] [-c x,y] "
+	    "[-s scale] [-z min,max]\n"
+	    "                          [-i iterations] "
+	    "[-m brute|trace|guess] -o path\n");
+	exit(EXIT_FAILURE);
+}
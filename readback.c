@@ -0,0 +1,138 @@
+// Copyright (c) 2025 Charles Hood <chood@chood.net>
+//
+// This program is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <GLES3/gl3.h>
+#include "readback.h"
+
+typedef struct {
+	GLuint buffer;
+	GLsync fence;
+	size_t capacity;
+	int width;
+	int height;
+	void *data;
+} Slot;
+
+// Reads the framebuffer into a ring of pixel buffer objects, each with a
+// fence that tells when the GPU has filled it, so that starting a readback
+// never waits for the frame to finish drawing and taking the pixels never
+// waits for the copy.
+struct Readback {
+	Slot *slots;
+	int count;
+	int head;
+	int tail;
+	int busy;
+};
+
+// The context that will read must be current.
+Readback *
+readback_create(int count)
+{
+	Readback *r = calloc(1, sizeof(Readback));
+	if (r == NULL) {
+		return NULL;
+	}
+	r->slots = calloc(count, sizeof(Slot));
+	if (r->slots == NULL) {
+		free(r);
+		return NULL;
+	}
+	r->count = count;
+	for (int i = 0; i < count; ++i) {
+		glGenBuffers(1, &r->slots[i].buffer);
+	}
+	return r;
+}
+
+// Drops any readback that has not been handed out.
+void
+readback_destroy(Readback *r)
+{
+	for (int i = 0; i < r->count; ++i) {
+		if (r->slots[i].fence != NULL) {
+			glDeleteSync(r->slots[i].fence);
+		}
+		glDeleteBuffers(1, &r->slots[i].buffer);
+	}
+	free(r->slots);
+	free(r);
+}
+
+// Starts reading the bottom left corner of the framebuffer that is bound for
+// reading. Returns false, and reads nothing, if every buffer is still busy.
+bool
+readback_start(Readback *r, int width, int height, void *data)
+{
+	if (r->busy == r->count) {
+		return false;
+	}
+	Slot *s = &r->slots[r->head];
+	size_t size = (size_t)width * height * 4;
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, s->buffer);
+	if (s->capacity < size) {
+		glBufferData(GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_READ);
+		s->capacity = size;
+	}
+	glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	s->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	s->width = width;
+	s->height = height;
+	s->data = data;
+	r->head = (r->head + 1) % r->count;
+	++r->busy;
+	return true;
+}
+
+// Hands finished readbacks to a function in the order they were started.
+// Unless told to wait, stops at the first one that is not finished yet.
+// Readbacks whose fence or mapping fails are reported and dropped. Returns
+// true if any readback is still in progress.
+bool
+readback_poll(Readback *r, ReadbackDone *done, bool wait)
+{
+	while (r->busy > 0) {
+		Slot *s = &r->slots[r->tail];
+		GLenum status = glClientWaitSync(s->fence,
+		    GL_SYNC_FLUSH_COMMANDS_BIT, wait ? GL_TIMEOUT_IGNORED : 0);
+		if (status == GL_TIMEOUT_EXPIRED) {
+			return true;
+		}
+		glDeleteSync(s->fence);
+		s->fence = NULL;
+
+		size_t size = (size_t)s->width * s->height * 4;
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, s->buffer);
+		void *pixels = status == GL_WAIT_FAILED ? NULL :
+		    glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size,
+		    GL_MAP_READ_BIT);
+		if (pixels != NULL) {
+			done(pixels, s->width, s->height, s->data);
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		} else {
+			fprintf(stderr, "readback of %dx%d pixels dropped, "
+			    "%s failed\n", s->width, s->height,
+			    status == GL_WAIT_FAILED ? "waiting for it" :
+			    "mapping it");
+		}
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		r->tail = (r->tail + 1) % r->count;
+		--r->busy;
+	}
+	return false;
+}
@@ -0,0 +1,34 @@
+// Copyright (c) 2025 Charles Hood <chood@chood.net>
+//
+// This program is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef READBACK_H
+#define READBACK_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct Readback Readback;
+
+// Receives the RGBA pixels of a finished readback, bottom row first, along
+// with the data given when it was started. The pixels are only valid during
+// the call.
+typedef void ReadbackDone(uint8_t const *, int, int, void *);
+
+Readback *readback_create(int);
+void readback_destroy(Readback *);
+bool readback_start(Readback *, int, int, void *);
+bool readback_poll(Readback *, ReadbackDone *, bool);
+
+#endif
@@ -0,0 +1,529 @@
+// Copyright (c) 2025 Charles Hood <chood@chood.net>
+//
+// This program is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "render.h"
+
+#define GUESS_STEP 16
+
+enum {
+	PIXEL_UNTOUCHED,
+	PIXEL_QUEUED,
+	PIXEL_DONE,
+	PIXEL_FILLED,
+};
+
+static void render_brute(Canvas *, Rect const *, RenderHooks const *);
+static bool render_trace(Canvas *, Rect const *, RenderHooks const *);
+static void render_guess(Canvas *, Rect const *, RenderHooks const *);
+static void guess_block(Canvas *, Rect const *, int, int, int,
+    RenderHooks const *);
+static void fill_blocks(Canvas *, Rect const *, int);
+static size_t enqueue_neighbors(uint8_t *, int *, size_t, int, int, int,
+    int);
+static size_t fill_regions(Canvas *, Rect const *, uint8_t *, int *, size_t,
+    int *);
+static bool cancelled(RenderHooks const *);
+static void compute(Canvas *, int, int, RenderHooks const *);
+static uint32_t iterate_counted(double, double, int, uint32_t *);
+
+uint32_t
+iterate(double cx, double cy, int cap)
+{
+	uint32_t steps;
+	return iterate_counted(cx, cy, cap, &steps);
+}
+
+// Iterates like iterate() and also returns the number of iterations that were
+// run, which is smaller than the count for orbits found to be periodic.
+static uint32_t
+iterate_counted(double cx, double cy, int cap, uint32_t *steps)
+{
+	double x = 0., y = 0., x2 = 0., y2 = 0., px = 0., py = 0.;
+	int i, check = 16;
+	for (i = 0; i < cap && x2 + y2 <= 4.; ++i) {
+		y = 2. * x * y + cy;
+		x = x2 - y2 + cx;
+		x2 = x * x;
+		y2 = y * y;
+
+		// An orbit that returns exactly to a point it has visited is
+		// periodic and never escapes. The point is moved along at every
+		// power of two so that cycles of any length are caught.
+		if (x == px && y == py) {
+			*steps = i + 1;
+			return cap;
+		}
+		if (i == check) {
+			px = x;
+			py = y;
+			check *= 2;
+		}
+	}
+	*steps = i;
+	return i;
+}
+
+// Iterates like iterate() while also tracking the derivative of z with
+// respect to c for the distance estimate.
+void
+sample(double cx, double cy, int cap, Sample *s)
+{
+	double x = 0., y = 0., x2 = 0., y2 = 0., dx = 0., dy = 0.;
+	int i;
+	for (i = 0; i < cap && x2 + y2 <= 4.; ++i) {
+		double t = 2. * (x * dx - y * dy) + 1.;
+		dy = 2. * (x * dy + y * dx);
+		dx = t;
+		y = 2. * x * y + cy;
+		x = x2 - y2 + cx;
+		x2 = x * x;
+		y2 = y * y;
+	}
+
+	s->count = i;
+	if (i >= cap) {
+		s->smooth = cap;
+		s->z[0] = s->z[1] = 0.;
+		s->distance = 0.;
+		return;
+	}
+	double r = sqrt(x2 + y2);
+	s->smooth = i + 1. - log2(log(r));
+	s->z[0] = x;
+	s->z[1] = y;
+	s->distance = r * log(r) / hypot(dx, dy);
+}
+
+void
+fit_view(View const *focus, int width, int height, View *v)
+{
+	v->x = focus->x;
+	v->y = focus->y;
+
+	double aspect_ratio = (double)width / height;
+	if (aspect_ratio >= focus->width / focus->height) {
+		v->width = focus->height * aspect_ratio;
+		v->height = focus->height;
+	} else {
+		v->width = focus->width;
+		v->height = focus->width / aspect_ratio;
+	}
+}
+
+bool
+canvas_init(Canvas *c, View const *view, int iterations, int width,
+    int height)
+{
+	c->view = *view;
+	c->iterations = iterations;
+	c->width = width;
+	c->height = height;
+	c->counts = calloc((size_t)width * height, sizeof(uint32_t));
+	return c->counts != NULL;
+}
+
+void
+canvas_free(Canvas *c)
+{
+	free(c->counts);
+	c->counts = NULL;
+}
+
+// Pixel centers map to the same points as fragment centers do in the shader,
+// except that rows are counted from the top.
+void
+canvas_point(Canvas const *c, int x, int y, double *p)
+{
+	p[0] = c->view.width * (2. * (x + .5) / c->width - 1.) + c->view.x;
+	p[1] = c->view.height * (1. - 2. * (y + .5) / c->height) + c->view.y;
+}
+
+// Returns false if the render was cancelled before it completed.
+bool
+render(Canvas *c, Rect const *r, RenderMode mode, RenderHooks const *hooks)
+{
+	switch (mode) {
+	case RENDER_MODE_TRACE:
+		if (render_trace(c, r, hooks)) {
+			return !cancelled(hooks);
+		}
+		break;
+	case RENDER_MODE_GUESS:
+		render_guess(c, r, hooks);
+		return !cancelled(hooks);
+	case RENDER_MODE_BRUTE:
+		break;
+	}
+	render_brute(c, r, hooks);
+	return !cancelled(hooks);
+}
+
+// Fills a canvas with the nearest counts of another one, using zero outside
+// of it, as a preview until it is rendered.
+void
+resample(Canvas const *from, Canvas *to)
+{
+	for (int y = 0; y < to->height; ++y) {
+		uint32_t *row = to->counts + (size_t)y * to->width;
+		for (int x = 0; x < to->width; ++x) {
+			double p[2];
+			canvas_point(to, x, y, p);
+			double fx = ((p[0] - from->view.x) / from->view.width +
+			    1.) * .5 * from->width;
+			double fy = (1. - (p[1] - from->view.y) /
+			    from->view.height) * .5 * from->height;
+			if (fx < 0. || fx >= from->width || fy < 0. ||
+			    fy >= from->height) {
+				row[x] = 0;
+				continue;
+			}
+			row[x] = from->counts[(size_t)fy * from->width +
+			    (size_t)fx];
+		}
+	}
+}
+
+// Writes the colors of a rectangle of a canvas into an RGBA image with the
+// dimensions of the canvas.
+void
+colorize(Canvas const *c, Rect const *r, uint8_t *rgba)
+{
+	uint32_t cap = c->iterations;
+	for (int y = r->y; y < r->y + r->height; ++y) {
+		size_t i = (size_t)y * c->width + r->x;
+		for (int x = 0; x < r->width; ++x, ++i) {
+			uint8_t v = c->counts[i] >= cap ? 255 : 0;
+			rgba[4 * i + 0] = v;
+			rgba[4 * i + 1] = v;
+			rgba[4 * i + 2] = v | 127;
+			rgba[4 * i + 3] = 255;
+		}
+	}
+}
+
+// Writes the costs of a rectangle of a canvas, as counted by render(), into an
+// RGBA image with the dimensions of the canvas. Pixels that cost nothing are
+// dark blue, and the rest go from red to yellow to white on a logarithmic
+// scale that ends at the iteration cap.
+void
+colorize_costs(Canvas const *c, uint32_t const *costs, Rect const *r,
+    uint8_t *rgba)
+{
+	double scale = 1. / log(c->iterations + 1.);
+	for (int y = r->y; y < r->y + r->height; ++y) {
+		size_t i = (size_t)y * c->width + r->x;
+		for (int x = 0; x < r->width; ++x, ++i) {
+			if (costs[i] == 0) {
+				rgba[4 * i + 0] = 0;
+				rgba[4 * i + 1] = 0;
+				rgba[4 * i + 2] = 96;
+				rgba[4 * i + 3] = 255;
+				continue;
+			}
+			double t = fmin(log(costs[i] + 1.) * scale, 1.);
+			rgba[4 * i + 0] = 64 + 191 * fmin(3. * t, 1.);
+			rgba[4 * i + 1] = 255 * fmin(fmax(3. * t - 1., 0.), 1.);
+			rgba[4 * i + 2] = 255 * fmax(3. * t - 2., 0.);
+			rgba[4 * i + 3] = 255;
+		}
+	}
+}
+
+char const *
+render_mode_name(RenderMode mode)
+{
+	switch (mode) {
+	case RENDER_MODE_BRUTE:
+		return "brute";
+	case RENDER_MODE_TRACE:
+		return "trace";
+	case RENDER_MODE_GUESS:
+		return "guess";
+	}
+	return "unknown";
+}
+
+bool
+render_mode_parse(char const *name, RenderMode *mode)
+{
+	RenderMode modes[] = {RENDER_MODE_BRUTE, RENDER_MODE_TRACE,
+	    RENDER_MODE_GUESS};
+	for (size_t i = 0; i < sizeof(modes) / sizeof(modes[0]); ++i) {
+		if (strcmp(name, render_mode_name(modes[i])) == 0) {
+			*mode = modes[i];
+			return true;
+		}
+	}
+	return false;
+}
+
+static void
+render_brute(Canvas *c, Rect const *r, RenderHooks const *hooks)
+{
+	for (int y = r->y; y < r->y + r->height; ++y) {
+		if (cancelled(hooks)) {
+			return;
+		}
+		for (int x = r->x; x < r->x + r->width; ++x) {
+			compute(c, x, y, hooks);
+		}
+	}
+}
+
+// Boundary tracing: starting from the edges of the rectangle, the neighbors of
+// a pixel are only computed when it differs from any of the eight pixels
+// around it that have already been computed. Regions of pixels that are never
+// reached are filled by fill_regions() if they are enclosed by a single count,
+// whether it escapes or not, and are computed otherwise.
+static bool
+render_trace(Canvas *c, Rect const *r, RenderHooks const *hooks)
+{
+	int w = r->width, h = r->height;
+	if (w <= 2 || h <= 2) {
+		return false;
+	}
+
+	size_t n = (size_t)w * h;
+	uint8_t *state = calloc(n, 1);
+	int *queue = malloc(n * sizeof(int));
+	int *region = malloc(n * sizeof(int));
+	if (state == NULL || queue == NULL || region == NULL) {
+		free(state);
+		free(queue);
+		free(region);
+		return false;
+	}
+
+	// The two outermost rings are computed, as the edge of the rectangle
+	// hides any difference with the pixels beyond it.
+	size_t head = 0, tail = 0;
+	for (int y = 0; y < h; ++y) {
+		for (int x = 0; x < w; ++x) {
+			if (x < 2 || x >= w - 2 || y < 2 || y >= h - 2) {
+				state[y * w + x] = PIXEL_QUEUED;
+				queue[tail++] = y * w + x;
+			}
+		}
+	}
+
+	uint32_t *counts = c->counts + (size_t)r->y * c->width + r->x;
+	while (head < tail) {
+		if (head % w == 0 && cancelled(hooks)) {
+			break;
+		}
+		int i = queue[head++];
+		int x = i % w, y = i / w;
+		compute(c, r->x + x, r->y + y, hooks);
+		state[i] = PIXEL_DONE;
+
+		uint32_t count = counts[y * c->width + x];
+		int neighbors[8][2] = {{x - 1, y}, {x + 1, y}, {x, y - 1},
+		    {x, y + 1}, {x - 1, y - 1}, {x + 1, y - 1}, {x - 1, y + 1},
+		    {x + 1, y + 1}};
+		for (int j = 0; j < 8; ++j) {
+			int nx = neighbors[j][0], ny = neighbors[j][1];
+			if (nx < 0 || nx >= w || ny < 0 || ny >= h ||
+			    state[ny * w + nx] != PIXEL_DONE ||
+			    counts[ny * c->width + nx] == count) {
+				continue;
+			}
+			tail = enqueue_neighbors(state, queue, tail, w, h, x,
+			    y);
+			tail = enqueue_neighbors(state, queue, tail, w, h, nx,
+			    ny);
+		}
+		if (head == tail) {
+			tail = fill_regions(c, r, state, queue, tail, region);
+		}
+	}
+
+	free(state);
+	free(queue);
+	free(region);
+	return true;
+}
+
+// Solid guessing: every GUESS_STEP-th pixel is computed first, then each pass
+// halves the step and only computes the new pixels of a block if its corners
+// disagree. Blocks are filled after each pass so that they can be shown as a
+// preview.
+static void
+render_guess(Canvas *c, Rect const *r, RenderHooks const *hooks)
+{
+	int step = GUESS_STEP;
+	for (int y = 0; y < r->height; y += step) {
+		for (int x = 0; x < r->width; x += step) {
+			compute(c, r->x + x, r->y + y, hooks);
+		}
+	}
+
+	for (; step > 1; step /= 2) {
+		fill_blocks(c, r, step);
+		if (hooks != NULL && hooks->progress != NULL) {
+			hooks->progress(c, r, hooks->data);
+		}
+
+		for (int y = 0; y < r->height; y += step) {
+			if (cancelled(hooks)) {
+				return;
+			}
+			for (int x = 0; x < r->width; x += step) {
+				guess_block(c, r, x, y, step, hooks);
+			}
+		}
+	}
+}
+
+static void
+guess_block(Canvas *c, Rect const *r, int x, int y, int step,
+    RenderHooks const *hooks)
+{
+	uint32_t *counts = c->counts + (size_t)r->y * c->width + r->x;
+	uint32_t count = counts[y * c->width + x];
+	bool uniform = x + step < r->width && y + step < r->height &&
+	    counts[y * c->width + x + step] == count &&
+	    counts[(y + step) * c->width + x] == count &&
+	    counts[(y + step) * c->width + x + step] == count;
+
+	int half = step / 2;
+	int points[3][2] = {{x + half, y}, {x, y + half}, {x + half, y + half}};
+	for (int i = 0; i < 3; ++i) {
+		int px = points[i][0], py = points[i][1];
+		if (px >= r->width || py >= r->height) {
+			continue;
+		}
+		if (uniform) {
+			counts[py * c->width + px] = count;
+		} else {
+			compute(c, r->x + px, r->y + py, hooks);
+		}
+	}
+}
+
+// Fills every step * step block with the count of its top left pixel.
+static void
+fill_blocks(Canvas *c, Rect const *r, int step)
+{
+	uint32_t *counts = c->counts + (size_t)r->y * c->width + r->x;
+	for (int y = 0; y < r->height; ++y) {
+		uint32_t *row = counts + (size_t)y * c->width;
+		uint32_t *source = counts + (size_t)(y - y % step) * c->width;
+		for (int x = 0; x < r->width; ++x) {
+			row[x] = source[x - x % step];
+		}
+	}
+}
+
+static size_t
+enqueue_neighbors(uint8_t *state, int *queue, size_t tail, int w, int h,
+    int x, int y)
+{
+	int neighbors[4][2] = {{x - 1, y}, {x + 1, y}, {x, y - 1}, {x, y + 1}};
+	for (int i = 0; i < 4; ++i) {
+		int nx = neighbors[i][0], ny = neighbors[i][1];
+		if (nx < 0 || nx >= w || ny < 0 || ny >= h ||
+		    state[ny * w + nx] != PIXEL_UNTOUCHED) {
+			continue;
+		}
+		state[ny * w + nx] = PIXEL_QUEUED;
+		queue[tail++] = ny * w + nx;
+	}
+	return tail;
+}
+
+// Fills every region of untouched pixels whose computed neighbors all share a
+// count with that count. A region whose neighbors differ holds a boundary
+// that tracing missed, so all of its pixels are queued instead. Every
+// untouched pixel is either filled or queued, so this only scans the
+// rectangle twice. Returns the new end of the queue.
+static size_t
+fill_regions(Canvas *c, Rect const *r, uint8_t *state, int *queue,
+    size_t tail, int *region)
+{
+	int w = r->width, h = r->height;
+	uint32_t *counts = c->counts + (size_t)r->y * c->width + r->x;
+	for (int start = 0; start < w * h; ++start) {
+		if (state[start] != PIXEL_UNTOUCHED) {
+			continue;
+		}
+
+		// Collects the region four-connected to the pixel, marking it
+		// as filled so that it is only collected once.
+		size_t size = 0;
+		region[size++] = start;
+		state[start] = PIXEL_FILLED;
+		bool enclosed = true, found = false;
+		uint32_t count = 0;
+		for (size_t k = 0; k < size; ++k) {
+			int x = region[k] % w, y = region[k] / w;
+			for (int dy = -1; dy <= 1; ++dy) {
+				for (int dx = -1; dx <= 1; ++dx) {
+					int nx = x + dx, ny = y + dy;
+					if (nx < 0 || nx >= w || ny < 0 ||
+					    ny >= h) {
+						continue;
+					}
+					int j = ny * w + nx;
+					if (state[j] == PIXEL_DONE) {
+						uint32_t n = counts[ny *
+						    c->width + nx];
+						enclosed &= !found || n == count;
+						found = true;
+						count = n;
+					} else if (state[j] ==
+					    PIXEL_UNTOUCHED && (dx == 0 ||
+					    dy == 0)) {
+						state[j] = PIXEL_FILLED;
+						region[size++] = j;
+					}
+				}
+			}
+		}
+
+		for (size_t k = 0; k < size; ++k) {
+			int x = region[k] % w, y = region[k] / w;
+			if (found && enclosed) {
+				counts[y * c->width + x] = count;
+			} else {
+				state[region[k]] = PIXEL_QUEUED;
+				queue[tail++] = region[k];
+			}
+		}
+	}
+	return tail;
+}
+
+static bool
+cancelled(RenderHooks const *hooks)
+{
+	return hooks != NULL && hooks->cancelled != NULL &&
+	    hooks->cancelled(hooks->data);
+}
+
+static void
+compute(Canvas *c, int x, int y, RenderHooks const *hooks)
+{
+	double p[2];
+	canvas_point(c, x, y, p);
+	size_t i = (size_t)y * c->width + x;
+	uint32_t steps;
+	c->counts[i] = iterate_counted(p[0], p[1], c->iterations, &steps);
+	if (hooks != NULL && hooks->costs != NULL) {
+		hooks->costs[i] += steps;
+	}
+}
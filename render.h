@@ -0,0 +1,95 @@
+// Copyright (c) 2025 Charles Hood <chood@chood.net>
+//
+// This program is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef RENDER_H
+#define RENDER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Identifies the iteration formula in files that keep its results. It has to
+// change whenever iterate() does.
+#define RENDER_FORMULA 1
+
+// A view is a center point and the half-width and half-height of the visible
+// area, the same layout as the transformation uniform.
+typedef struct {
+	double x;
+	double y;
+	double width;
+	double height;
+} View;
+
+typedef struct {
+	int x;
+	int y;
+	int width;
+	int height;
+} Rect;
+
+// Escape counts for a width * height image of a view, top row first. Pixels
+// that do not escape within the iteration cap have a count equal to the cap.
+typedef struct {
+	View view;
+	int iterations;
+	int width;
+	int height;
+	uint32_t *counts;
+} Canvas;
+
+typedef enum {
+	RENDER_MODE_BRUTE,
+	RENDER_MODE_TRACE,
+	RENDER_MODE_GUESS,
+} RenderMode;
+
+// The escape count of a point with the smooth count, the final value of z
+// and an estimate of the distance to the set, which are zero for points that
+// do not escape.
+typedef struct {
+	uint32_t count;
+	double smooth;
+	double z[2];
+	double distance;
+} Sample;
+
+// Optional hooks into a render. Progressive render modes call progress after
+// each pass that leaves a complete preview in the rectangle, and every mode
+// checks cancelled regularly and stops early once it returns true. Unless
+// costs is NULL, the iterations computed for each pixel are added to it, laid
+// out like the counts, so pixels that a mode fills in without iterating keep
+// their cost.
+typedef struct {
+	void (*progress)(Canvas *, Rect const *, void *);
+	bool (*cancelled)(void *);
+	void *data;
+	uint32_t *costs;
+} RenderHooks;
+
+uint32_t iterate(double, double, int);
+void sample(double, double, int, Sample *);
+void fit_view(View const *, int, int, View *);
+bool canvas_init(Canvas *, View const *, int, int, int);
+void canvas_free(Canvas *);
+void canvas_point(Canvas const *, int, int, double *);
+bool render(Canvas *, Rect const *, RenderMode, RenderHooks const *);
+void resample(Canvas const *, Canvas *);
+void colorize(Canvas const *, Rect const *, uint8_t *);
+void colorize_costs(Canvas const *, uint32_t const *, Rect const *,
+    uint8_t *);
+char const *render_mode_name(RenderMode);
+bool render_mode_parse(char const *, RenderMode *);
+
+#endif
@@ -0,0 +1,583 @@
+// Copyright (c) 2025 Charles Hood <chood@chood.net>
+//
+// This program is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+
+#include <math.h>
+#include <stdlib.h>
+#include "cache.h"
+#include "codec.h"
+#include "pool.h"
+#include "renderer.h"
+#include "trace.h"
+
+// Every column and row of a frame mapped to a tile of one level and to a
+// column or row of pixels inside that tile.
+typedef struct {
+	int level;
+	int64_t *column_tiles;
+	int *columns;
+	int64_t *row_tiles;
+	int *rows;
+	int width;
+	int height;
+} Grid;
+
+typedef struct {
+	Renderer *renderer;
+	Grid const *grid;
+	TileKey key;
+	int generation;
+	double distance;
+	bool heatmap;
+	uint32_t *costs;
+} Job;
+
+// Frames are composed from the tiles of a cache on a thread of their own,
+// which hands the tiles that are missing to the pool. The newest frame is
+// shared with the event loop, which is woken up with an event of the given
+// type whenever part of it has changed.
+//
+// Every request starts a new generation. Tiles of older generations stop as
+// soon as they notice, so that only the newest view is being worked on.
+struct Renderer {
+	Pool *pool;
+	Cache *cache;
+	Store *store;
+	SDL_Thread *thread;
+	Uint32 event_type;
+	SDL_AtomicInt woken;
+	SDL_AtomicInt generation;
+
+	SDL_Mutex *mutex;
+	SDL_Condition *requested;
+	FrameRequest request;
+	bool pending;
+
+	SDL_Mutex *frame_mutex;
+	Frame frame;
+	Rect dirty;
+};
+
+static int run_renderer(void *);
+static void render_frame(Renderer *, FrameRequest const *, int);
+static Job *compose(Renderer *, Canvas *, Grid const *, RenderMode, bool,
+    int *);
+static void render_job(void *);
+static bool job_cancelled(void *);
+static void publish_tile(Canvas *, Rect const *, void *);
+static void wake(Renderer *);
+static bool grid_init(Grid *, Canvas const *, int);
+static void grid_free(Grid *);
+static void overlay(uint32_t *, Grid const *, TileKey const *,
+    uint32_t const *, Rect *);
+static void span(int64_t const *, int, int64_t, int *, int *);
+static uint64_t visible_cost(Job const *, uint64_t *);
+static int cmp_job(void const *, void const *);
+static void extend(Rect *, Rect const *);
+
+// The cache budget is in bytes. Tiles are also looked up in and saved to the
+// store, unless it is NULL.
+Renderer *
+renderer_create(Uint32 event_type, size_t cache_budget, Store *store)
+{
+	Renderer *r = calloc(1, sizeof(Renderer));
+	if (r == NULL) {
+		return NULL;
+	}
+	r->event_type = event_type;
+	r->store = store;
+	r->pool = pool_create(0);
+	r->cache = cache_create(cache_budget);
+	r->mutex = SDL_CreateMutex();
+	r->requested = SDL_CreateCondition();
+	r->frame_mutex = SDL_CreateMutex();
+	if (r->pool == NULL || r->cache == NULL || r->mutex == NULL ||
+	    r->requested == NULL || r->frame_mutex == NULL) {
+		return NULL;
+	}
+
+	r->thread = SDL_CreateThread(run_renderer, "renderer", r);
+	if (r->thread == NULL) {
+		return NULL;
+	}
+	return r;
+}
+
+// Replaces any request that the render thread has not started on yet.
+// Returns the generation of the frames that will be rendered for it.
+int
+renderer_request(Renderer *r, FrameRequest const *request)
+{
+	SDL_LockMutex(r->mutex);
+	r->request = *request;
+	r->pending = true;
+	int generation = SDL_AddAtomicInt(&r->generation, 1) + 1;
+	SDL_SignalCondition(r->requested);
+	SDL_UnlockMutex(r->mutex);
+	return generation;
+}
+
+// Returns the newest frame, or NULL if there is none yet, along with the part
+// of it that has changed since the last call. The frame must be unlocked
+// before the next event is handled.
+Frame const *
+renderer_lock_frame(Renderer *r, Rect *dirty)
+{
+	SDL_LockMutex(r->frame_mutex);
+	SDL_SetAtomicInt(&r->woken, 0);
+	*dirty = r->dirty;
+	r->dirty.width = 0;
+	r->dirty.height = 0;
+	return r->frame.pixels != NULL ? &r->frame : NULL;
+}
+
+void
+renderer_unlock_frame(Renderer *r)
+{
+	SDL_UnlockMutex(r->frame_mutex);
+}
+
+static int
+run_renderer(void *data)
+{
+	Renderer *r = data;
+	trace_thread("renderer");
+	for (;;) {
+		SDL_LockMutex(r->mutex);
+		while (!r->pending) {
+			SDL_WaitCondition(r->requested, r->mutex);
+		}
+		FrameRequest request = r->request;
+		int generation = SDL_GetAtomicInt(&r->generation);
+		r->pending = false;
+		SDL_UnlockMutex(r->mutex);
+
+		render_frame(r, &request, generation);
+	}
+	return 0;
+}
+
+// The new frame starts out as a resampled copy of the previous one, covered
+// with whatever cached tiles there are of nearby levels, so that the event
+// loop always has a complete image to show.
+static void
+render_frame(Renderer *r, FrameRequest const *request, int generation)
+{
+	if (SDL_GetAtomicInt(&r->generation) != generation) {
+		return;
+	}
+
+	Uint64 span = trace_begin();
+	Frame frame;
+	if (!canvas_init(&frame.canvas, &request->view, request->iterations,
+	    request->width, request->height)) {
+		return;
+	}
+	frame.pixels = malloc((size_t)request->width * request->height * 4);
+	if (frame.pixels == NULL) {
+		canvas_free(&frame.canvas);
+		return;
+	}
+	frame.costs = NULL;
+	frame.cost = 0;
+	frame.cost_pixels = 0;
+	if (request->heatmap) {
+		frame.costs = calloc((size_t)request->width * request->height,
+		    sizeof(uint32_t));
+		if (frame.costs == NULL) {
+			canvas_free(&frame.canvas);
+			free(frame.pixels);
+			return;
+		}
+	}
+	frame.generation = generation;
+	frame.complete = false;
+	if (r->frame.pixels != NULL) {
+		resample(&r->frame.canvas, &frame.canvas);
+	}
+
+	// A heatmap only shows the tiles that are rendered, so nearby levels
+	// are of no use to it.
+	int level = tile_level(&request->view, request->width);
+	int levels[] = {level - 3, level - 2, level - 1, level + 1};
+	for (size_t i = 0; i < SDL_arraysize(levels) && !request->heatmap;
+	    ++i) {
+		Grid grid;
+		if (levels[i] >= 0 && grid_init(&grid, &frame.canvas,
+		    levels[i])) {
+			free(compose(r, &frame.canvas, &grid, request->mode,
+			    false, NULL));
+			grid_free(&grid);
+		}
+	}
+
+	Grid grid;
+	int job_count = 0;
+	Job *jobs = NULL;
+	if (grid_init(&grid, &frame.canvas, level)) {
+		jobs = compose(r, &frame.canvas, &grid, request->mode,
+		    request->heatmap, &job_count);
+	}
+
+	Rect all = {0, 0, request->width, request->height};
+	if (frame.costs != NULL) {
+		colorize_costs(&frame.canvas, frame.costs, &all, frame.pixels);
+	} else {
+		colorize(&frame.canvas, &all, frame.pixels);
+	}
+
+	SDL_LockMutex(r->frame_mutex);
+	canvas_free(&r->frame.canvas);
+	free(r->frame.pixels);
+	free(r->frame.costs);
+	r->frame = frame;
+	r->dirty = all;
+	SDL_UnlockMutex(r->frame_mutex);
+	wake(r);
+	trace_end("compose", span);
+
+	if (jobs == NULL) {
+		return;
+	}
+	span = trace_begin();
+	for (int i = 0; i < job_count; ++i) {
+		jobs[i].renderer = r;
+		jobs[i].generation = generation;
+		jobs[i].heatmap = request->heatmap;
+		pool_submit(r->pool, render_job, &jobs[i]);
+	}
+	trace_end("schedule", span);
+	span = trace_begin();
+	pool_wait(r->pool);
+	trace_end("wait for tiles", span);
+	free(jobs);
+	grid_free(&grid);
+
+	SDL_LockMutex(r->frame_mutex);
+	r->frame.complete = SDL_GetAtomicInt(&r->generation) == generation;
+	SDL_UnlockMutex(r->frame_mutex);
+	wake(r);
+}
+
+// Copies every cached tile of the grid's level into the canvas. If jobs are
+// wanted, returns the tiles that are missing, closest to the center first,
+// or every tile if the cache is bypassed.
+static Job *
+compose(Renderer *r, Canvas *c, Grid const *grid, RenderMode mode,
+    bool bypass, int *job_count)
+{
+	int64_t x0 = grid->column_tiles[0];
+	int64_t x1 = grid->column_tiles[grid->width - 1];
+	int64_t y0 = grid->row_tiles[grid->height - 1];
+	int64_t y1 = grid->row_tiles[0];
+
+	uint32_t *counts = malloc(CODEC_BOUND(TILE_SIZE * TILE_SIZE));
+	if (counts == NULL) {
+		return NULL;
+	}
+	Job *jobs = NULL;
+	if (job_count != NULL) {
+		*job_count = 0;
+		jobs = malloc((size_t)(x1 - x0 + 1) * (y1 - y0 + 1) *
+		    sizeof(Job));
+		if (jobs == NULL) {
+			free(counts);
+			return NULL;
+		}
+	}
+
+	cache_lock(r->cache);
+	for (int64_t y = y0; y <= y1; ++y) {
+		for (int64_t x = x0; x <= x1; ++x) {
+			TileKey key = {grid->level, x, y, c->iterations, mode};
+			size_t length;
+			uint8_t const *data = bypass ? NULL :
+			    cache_find(r->cache, &key, &length);
+			if (data != NULL && codec_decode(data, length,
+			    TILE_SIZE, TILE_SIZE, counts)) {
+				Rect bounds;
+				overlay(c->counts, grid, &key, counts,
+				    &bounds);
+			} else if (jobs != NULL) {
+				Job *job = &jobs[(*job_count)++];
+				job->grid = grid;
+				job->key = key;
+				job->costs = NULL;
+				job->distance = hypot(x - .5 * (x0 + x1),
+				    y - .5 * (y0 + y1));
+			}
+		}
+	}
+	cache_unlock(r->cache);
+	free(counts);
+
+	if (jobs != NULL) {
+		qsort(jobs, *job_count, sizeof(Job), cmp_job);
+	}
+	return jobs;
+}
+
+static void
+render_job(void *data)
+{
+	Job *job = data;
+	Renderer *r = job->renderer;
+	if (job_cancelled(job)) {
+		return;
+	}
+	Uint64 span = trace_begin();
+
+	View view;
+	tile_view(&job->key, &view);
+	Canvas c;
+	if (!canvas_init(&c, &view, job->key.iterations, TILE_SIZE,
+	    TILE_SIZE)) {
+		return;
+	}
+
+	// Frames that count costs render every tile.
+	Rect all = {0, 0, TILE_SIZE, TILE_SIZE};
+	bool heatmap = job->heatmap;
+	if (heatmap) {
+		job->costs = calloc(TILE_SIZE * TILE_SIZE, sizeof(uint32_t));
+		if (job->costs == NULL) {
+			canvas_free(&c);
+			return;
+		}
+	}
+	bool stored = r->store != NULL && !heatmap &&
+	    store_load(r->store, &job->key, c.counts);
+	if (!stored) {
+		RenderHooks hooks = {publish_tile, job_cancelled, job,
+		    job->costs};
+		if (!render(&c, &all, job->key.mode, &hooks)) {
+			canvas_free(&c);
+			free(job->costs);
+			trace_end("cancelled tile", span);
+			return;
+		}
+	}
+	publish_tile(&c, &all, job);
+	if (heatmap) {
+		uint64_t pixels;
+		uint64_t cost = visible_cost(job, &pixels);
+		free(job->costs);
+		SDL_LockMutex(r->frame_mutex);
+		if (!job_cancelled(job)) {
+			r->frame.cost += cost;
+			r->frame.cost_pixels += pixels;
+		}
+		SDL_UnlockMutex(r->frame_mutex);
+	}
+
+	// The tile is encoded here rather than under the cache's lock, so
+	// that the panning thread only ever waits for a decode.
+	uint8_t *encoded = malloc(CODEC_BOUND(TILE_SIZE * TILE_SIZE));
+	if (encoded == NULL) {
+		canvas_free(&c);
+		return;
+	}
+	size_t length = codec_encode(c.counts, TILE_SIZE, TILE_SIZE, encoded);
+	canvas_free(&c);
+	if (r->store != NULL && !stored) {
+		store_save(r->store, &job->key, encoded, length);
+	}
+	uint8_t *shrunk = realloc(encoded, length);
+	if (shrunk != NULL) {
+		encoded = shrunk;
+	}
+
+	cache_lock(r->cache);
+	cache_insert(r->cache, &job->key, encoded, length);
+	cache_unlock(r->cache);
+	trace_end(stored ? "stored tile" : "tile", span);
+}
+
+static bool
+job_cancelled(void *data)
+{
+	Job *job = data;
+	return job->generation !=
+	    SDL_GetAtomicInt(&job->renderer->generation);
+}
+
+static void
+publish_tile(Canvas *c, Rect const *rect, void *data)
+{
+	(void)rect;
+
+	// The frame is only replaced after the generation has moved on, so a
+	// job that is still current under the lock draws into its own frame.
+	Job *job = data;
+	Renderer *r = job->renderer;
+	SDL_LockMutex(r->frame_mutex);
+	if (job_cancelled(job)) {
+		SDL_UnlockMutex(r->frame_mutex);
+		return;
+	}
+	Rect bounds;
+	overlay(r->frame.canvas.counts, job->grid, &job->key, c->counts,
+	    &bounds);
+	if (r->frame.costs != NULL) {
+		overlay(r->frame.costs, job->grid, &job->key, job->costs,
+		    &bounds);
+		colorize_costs(&r->frame.canvas, r->frame.costs, &bounds,
+		    r->frame.pixels);
+	} else {
+		colorize(&r->frame.canvas, &bounds, r->frame.pixels);
+	}
+	extend(&r->dirty, &bounds);
+	SDL_UnlockMutex(r->frame_mutex);
+	wake(r);
+}
+
+static void
+wake(Renderer *r)
+{
+	if (SDL_CompareAndSwapAtomicInt(&r->woken, 0, 1)) {
+		SDL_Event e;
+		SDL_zero(e);
+		e.type = r->event_type;
+		SDL_PushEvent(&e);
+	}
+}
+
+static bool
+grid_init(Grid *g, Canvas const *c, int level)
+{
+	g->level = level;
+	g->width = c->width;
+	g->height = c->height;
+	g->column_tiles = malloc(c->width * sizeof(int64_t));
+	g->columns = malloc(c->width * sizeof(int));
+	g->row_tiles = malloc(c->height * sizeof(int64_t));
+	g->rows = malloc(c->height * sizeof(int));
+	if (g->column_tiles == NULL || g->columns == NULL ||
+	    g->row_tiles == NULL || g->rows == NULL) {
+		grid_free(g);
+		return false;
+	}
+
+	double width = ldexp(TILE_EXTENT, -level);
+	for (int x = 0; x < c->width; ++x) {
+		double p[2];
+		canvas_point(c, x, 0, p);
+		double tile = floor(p[0] / width);
+		int column = (p[0] / width - tile) * TILE_SIZE;
+		g->column_tiles[x] = tile;
+		g->columns[x] = SDL_min(column, TILE_SIZE - 1);
+	}
+	for (int y = 0; y < c->height; ++y) {
+		double p[2];
+		canvas_point(c, 0, y, p);
+		double tile = floor(p[1] / width);
+		int row = (1. - (p[1] / width - tile)) * TILE_SIZE;
+		g->row_tiles[y] = tile;
+		g->rows[y] = SDL_min(row, TILE_SIZE - 1);
+	}
+	return true;
+}
+
+static void
+grid_free(Grid *g)
+{
+	free(g->column_tiles);
+	free(g->columns);
+	free(g->row_tiles);
+	free(g->rows);
+}
+
+// Copies a plane of a tile, such as its counts, into every pixel of the
+// grid's plane that it covers and returns the rectangle of those pixels.
+static void
+overlay(uint32_t *plane, Grid const *g, TileKey const *key,
+    uint32_t const *counts, Rect *bounds)
+{
+	int x0, x1, y0, y1;
+	span(g->column_tiles, g->width, key->x, &x0, &x1);
+	span(g->row_tiles, g->height, key->y, &y0, &y1);
+
+	for (int y = y0; y < y1; ++y) {
+		uint32_t *row = plane + (size_t)y * g->width;
+		uint32_t const *source = counts + g->rows[y] * TILE_SIZE;
+		for (int x = x0; x < x1; ++x) {
+			row[x] = source[g->columns[x]];
+		}
+	}
+
+	bounds->x = x0;
+	bounds->y = y0;
+	bounds->width = x1 - x0;
+	bounds->height = y1 - y0;
+}
+
+// Finds the range of indices that map to a tile.
+static void
+span(int64_t const *tiles, int n, int64_t tile, int *start, int *end)
+{
+	*start = 0;
+	while (*start < n && tiles[*start] != tile) {
+		++*start;
+	}
+	*end = *start;
+	while (*end < n && tiles[*end] == tile) {
+		++*end;
+	}
+}
+
+// Adds up the costs of the pixels of a job's tile that its frame shows, whose
+// number is also returned.
+static uint64_t
+visible_cost(Job const *job, uint64_t *pixels)
+{
+	Grid const *g = job->grid;
+	int x0, x1, y0, y1;
+	span(g->column_tiles, g->width, job->key.x, &x0, &x1);
+	span(g->row_tiles, g->height, job->key.y, &y0, &y1);
+
+	uint64_t cost = 0;
+	for (int y = y0; y < y1; ++y) {
+		uint32_t const *row = job->costs + g->rows[y] * TILE_SIZE;
+		for (int x = x0; x < x1; ++x) {
+			cost += row[g->columns[x]];
+		}
+	}
+	*pixels = (uint64_t)(x1 - x0) * (y1 - y0);
+	return cost;
+}
+
+static int
+cmp_job(void const *a, void const *b)
+{
+	double d = ((Job const *)a)->distance - ((Job const *)b)->distance;
+	return (d > 0.) - (d < 0.);
+}
+
+static void
+extend(Rect *r, Rect const *other)
+{
+	if (other->width == 0 || other->height == 0) {
+		return;
+	}
+	if (r->width == 0 || r->height == 0) {
+		*r = *other;
+		return;
+	}
+	int x1 = SDL_max(r->x + r->width, other->x + other->width);
+	int y1 = SDL_max(r->y + r->height, other->y + other->height);
+	r->x = SDL_min(r->x, other->x);
+	r->y = SDL_min(r->y, other->y);
+	r->width = x1 - r->x;
+	r->height = y1 - r->y;
+}
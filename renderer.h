@@ -0,0 +1,56 @@
+// Copyright (c) 2025 Charles Hood <chood@chood.net>
+//
+// This program is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef RENDERER_H
+#define RENDERER_H
+
+#include <SDL3/SDL.h>
+#include "render.h"
+#include "store.h"
+
+typedef struct {
+	View view;
+	int iterations;
+	int width;
+	int height;
+	RenderMode mode;
+	bool heatmap;
+} FrameRequest;
+
+// A frame is complete once every tile of its request has been rendered.
+//
+// Frames of heatmap requests render every tile again rather than take them
+// from the cache or the store, and keep the iterations computed for each
+// pixel in costs, which the pixels show instead of the counts. The total over
+// the pixels of the frame that finished tiles cover is in cost, and their
+// number in cost_pixels. Otherwise costs is NULL.
+typedef struct {
+	Canvas canvas;
+	uint8_t *pixels;
+	uint32_t *costs;
+	uint64_t cost;
+	uint64_t cost_pixels;
+	int generation;
+	bool complete;
+} Frame;
+
+typedef struct Renderer Renderer;
+
+Renderer *renderer_create(Uint32, size_t, Store *);
+int renderer_request(Renderer *, FrameRequest const *);
+Frame const *renderer_lock_frame(Renderer *, Rect *);
+void renderer_unlock_frame(Renderer *);
+
+#endif
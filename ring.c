@@ -0,0 +1,289 @@
+// Copyright (c) 2025 Charles Hood <chood@chood.net>
+//
+// This program is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <SDL3/SDL.h>
+#include "image.h"
+#include "ring.h"
+
+#define RING_MAGIC "MBFRAME1"
+#define RING_SLOTS 3
+#define RING_HEADER_BYTES 64
+
+// The shared memory object is this header followed by RING_SLOTS slots of
+// slot_bytes each. A slot is a RingSlot, padded to RING_HEADER_BYTES, and the
+// RGBA pixels of a frame, top row first.
+//
+// Frames are numbered from 1. The writer puts frame n in slot n % RING_SLOTS:
+// it sets the slot's sequence to 0, fills in the frame, sets the sequence to
+// n and then sets latest to n. A reader takes latest, copies its slot and
+// keeps the copy only if the slot's sequence was n both before and after.
+typedef struct {
+	char magic[8];
+	uint32_t slot_count;
+	uint32_t max_width;
+	uint32_t max_height;
+	uint32_t reserved;
+	uint64_t slot_bytes;
+	SDL_AtomicInt latest;
+	SDL_AtomicInt closed;
+} RingHeader;
+
+typedef struct {
+	SDL_AtomicInt sequence;
+	uint32_t width;
+	uint32_t height;
+	uint32_t reserved;
+	uint64_t nanoseconds;
+} RingSlot;
+
+struct FrameRing {
+	char *name;
+	uint8_t *map;
+	size_t size;
+	int max_width;
+	int max_height;
+	int sequence;
+};
+
+static void *map_ring(char const *, size_t *);
+static RingSlot *ring_slot(uint8_t *, int);
+static void frames_usage(void);
+
+// Creates a shared memory object with the given name, such as "/mandelbrot",
+// for frames of up to the given size, replacing any object of that name.
+FrameRing *
+ring_create(char const *name, int max_width, int max_height)
+{
+	FrameRing *r = calloc(1, sizeof(FrameRing));
+	char *copy = malloc(strlen(name) + 1);
+	if (r == NULL || copy == NULL) {
+		free(r);
+		free(copy);
+		return NULL;
+	}
+	strcpy(copy, name);
+	r->name = copy;
+	r->max_width = max_width;
+	r->max_height = max_height;
+
+	uint64_t slot_bytes = RING_HEADER_BYTES +
+	    (uint64_t)max_width * max_height * 4;
+	r->size = RING_HEADER_BYTES + RING_SLOTS * slot_bytes;
+	shm_unlink(name);
+	int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+	if (fd == -1) {
+		goto fail;
+	}
+	bool ok = ftruncate(fd, r->size) == 0;
+	r->map = ok ? mmap(NULL, r->size, PROT_READ | PROT_WRITE, MAP_SHARED,
+	    fd, 0) : MAP_FAILED;
+	close(fd);
+	if (r->map == MAP_FAILED) {
+		shm_unlink(name);
+		goto fail;
+	}
+
+	RingHeader *h = (RingHeader *)r->map;
+	memcpy(h->magic, RING_MAGIC, sizeof(h->magic));
+	h->slot_count = RING_SLOTS;
+	h->max_width = max_width;
+	h->max_height = max_height;
+	h->slot_bytes = slot_bytes;
+	SDL_SetAtomicInt(&h->closed, 0);
+	SDL_SetAtomicInt(&h->latest, 0);
+	return r;
+
+fail:
+	free(r->name);
+	free(r);
+	return NULL;
+}
+
+// Tells readers that no more frames are coming and removes the object,
+// which stays mapped by readers until they let go of it.
+void
+ring_destroy(FrameRing *r)
+{
+	RingHeader *h = (RingHeader *)r->map;
+	SDL_SetAtomicInt(&h->closed, 1);
+	munmap(r->map, r->size);
+	shm_unlink(r->name);
+	free(r->name);
+	free(r);
+}
+
+// Publishes a frame given bottom row first, as read from OpenGL. Frames that
+// are larger than the ring's slots are dropped.
+void
+ring_publish(FrameRing *r, uint8_t const *rgba, int width, int height)
+{
+	if (width > r->max_width || height > r->max_height) {
+		return;
+	}
+	int n = ++r->sequence;
+	RingSlot *s = ring_slot(r->map, n % RING_SLOTS);
+	// The fence keeps the pixels from becoming visible before readers can
+	// see that the slot is being written.
+	SDL_SetAtomicInt(&s->sequence, 0);
+	SDL_MemoryBarrierRelease();
+	s->width = width;
+	s->height = height;
+	s->nanoseconds = SDL_GetTicksNS();
+	uint8_t *pixels = (uint8_t *)s + RING_HEADER_BYTES;
+	size_t stride = (size_t)width * 4;
+	for (int y = 0; y < height; ++y) {
+		memcpy(pixels + y * stride, rgba + (height - 1 - y) * stride,
+		    stride);
+	}
+	SDL_SetAtomicInt(&s->sequence, n);
+	SDL_SetAtomicInt(&((RingHeader *)r->map)->latest, n);
+}
+
+// Reads frames from a ring as they are published and writes them to
+// standard output as a Y4M stream, as an example of a reader. Frames that
+// are published faster than they can be written are skipped.
+int
+frames_main(int argc, char **argv)
+{
+	int fps = 60;
+	long limit = -1;
+	int c;
+	while ((c = getopt(argc, argv, "n:r:")) != -1) {
+		if (c == 'n') {
+			limit = atol(optarg);
+		} else if (c == 'r' && atoi(optarg) > 0) {
+			fps = atoi(optarg);
+		} else {
+			frames_usage();
+		}
+	}
+	if (optind != argc - 1) {
+		frames_usage();
+	}
+	if (isatty(STDOUT_FILENO)) {
+		fprintf(stderr, "refusing to write a video to a terminal\n");
+		return EXIT_FAILURE;
+	}
+
+	size_t size;
+	uint8_t *map = map_ring(argv[optind], &size);
+	if (map == NULL) {
+		fprintf(stderr, "%s: not a frame ring\n", argv[optind]);
+		return EXIT_FAILURE;
+	}
+	RingHeader *h = (RingHeader *)map;
+	size_t capacity = (size_t)h->max_width * h->max_height * 4;
+	uint8_t *rgba = malloc(capacity);
+	uint8_t *yuv = malloc(capacity / 4 * 3);
+	if (rgba == NULL || yuv == NULL) {
+		exit(EXIT_FAILURE);
+	}
+
+	int last = 0, width = 0, height = 0;
+	long written = 0, skipped = 0;
+	bool ok = true;
+	while (ok && written != limit) {
+		int n = SDL_GetAtomicInt(&h->latest);
+		if (n == last) {
+			if (SDL_GetAtomicInt(&h->closed)) {
+				break;
+			}
+			SDL_Delay(1);
+			continue;
+		}
+
+		RingSlot *s = ring_slot(map, n % RING_SLOTS);
+		if (SDL_GetAtomicInt(&s->sequence) != n) {
+			continue;
+		}
+		int w = s->width, hh = s->height;
+		if (w <= 0 || hh <= 0 || w > (int)h->max_width ||
+		    hh > (int)h->max_height) {
+			continue;
+		}
+		memcpy(rgba, (uint8_t *)s + RING_HEADER_BYTES,
+		    (size_t)w * hh * 4);
+		SDL_MemoryBarrierAcquire();
+		if (SDL_GetAtomicInt(&s->sequence) != n) {
+			continue;
+		}
+
+		if (width == 0) {
+			width = w;
+			height = hh;
+			ok = y4m_write_header(stdout, width, height, fps);
+		} else if (w != width || hh != height) {
+			fprintf(stderr, "frame size changed, stopping\n");
+			break;
+		}
+		skipped += last != 0 ? n - last - 1 : 0;
+		last = n;
+		rgba_to_yuv(rgba, width, height, yuv);
+		ok = ok && y4m_write_frame(stdout, yuv, width, height);
+		++written;
+	}
+	ok = ok && fflush(stdout) == 0;
+	fprintf(stderr, "%ld frames written, %ld skipped\n", written,
+	    skipped);
+
+	free(rgba);
+	free(yuv);
+	munmap(map, size);
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Maps an existing ring and checks its header. Returns NULL on failure.
+static void *
+map_ring(char const *name, size_t *size)
+{
+	int fd = shm_open(name, O_RDWR, 0);
+	if (fd == -1) {
+		return NULL;
+	}
+	RingHeader h;
+	bool ok = pread(fd, &h, sizeof(h), 0) == sizeof(h) &&
+	    memcmp(h.magic, RING_MAGIC, sizeof(h.magic)) == 0 &&
+	    h.slot_count == RING_SLOTS &&
+	    h.slot_bytes == RING_HEADER_BYTES +
+	    (uint64_t)h.max_width * h.max_height * 4;
+	*size = RING_HEADER_BYTES + RING_SLOTS * h.slot_bytes;
+	void *map = ok ? mmap(NULL, *size, PROT_READ | PROT_WRITE, MAP_SHARED,
+	    fd, 0) : MAP_FAILED;
+	close(fd);
+	return map != MAP_FAILED ? map : NULL;
+}
+
+static RingSlot *
+ring_slot(uint8_t *map, int index)
+{
+	RingHeader const *h = (RingHeader const *)map;
+	return (RingSlot *)(map + RING_HEADER_BYTES + index * h->slot_bytes);
+}
+
+static void
+frames_usage(void)
+{
+	fprintf(stderr, "usage: mandelbrot frames [-n frames] [-r fps] name "
+	    "> file.y4m\n");
+	exit(EXIT_FAILURE);
+}
@@ -0,0 +1,28 @@
+// Copyright (c) 2025 Charles Hood <chood@chood.net>
+//
+// This program is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef RING_H
+#define RING_H
+
+#include <stdint.h>
+
+typedef struct FrameRing FrameRing;
+
+FrameRing *ring_create(char const *, int, int);
+void ring_destroy(FrameRing *);
+void ring_publish(FrameRing *, uint8_t const *, int, int);
+int frames_main(int, char **);
+
+#endif
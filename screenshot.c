@@ -0,0 +1,260 @@
+// Copyright (c) 2025 Charles Hood <chood@chood.net>
+//
+// This program is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL3/SDL.h>
+#include "backend.h"
+#include "image.h"
+#include "iterfile.h"
+#include "screenshot.h"
+
+#define SCREENSHOT_QUEUE 4
+#define SCREENSHOT_PATH_BYTES 256
+
+// A screenshot is either pixels that were read from the window, bottom row
+// first, or a view to render, which has no pixels. A view can also be saved
+// as an iteration file rather than an image.
+typedef struct Shot Shot;
+struct Shot {
+	char path[SCREENSHOT_PATH_BYTES];
+	uint8_t *rgba;
+	int width;
+	int height;
+	char const *backend;
+	Canvas canvas;
+	RenderMode mode;
+	bool iterations;
+	Shot *next;
+};
+
+// Screenshots are encoded and written by a thread of their own, so that the
+// window only waits for a copy of the pixels.
+struct Screenshots {
+	SDL_Mutex *mutex;
+	SDL_Condition *changed;
+	Shot *head;
+	Shot *tail;
+	int pending;
+	bool quit;
+	SDL_Thread *thread;
+};
+
+static bool enqueue(Screenshots *, Shot *);
+static int run_saver(void *);
+static bool save(Shot *);
+
+Screenshots *
+screenshots_create(void)
+{
+	Screenshots *s = calloc(1, sizeof(Screenshots));
+	if (s == NULL) {
+		return NULL;
+	}
+	s->mutex = SDL_CreateMutex();
+	s->changed = SDL_CreateCondition();
+	if (s->mutex == NULL || s->changed == NULL) {
+		goto fail;
+	}
+	s->thread = SDL_CreateThread(run_saver, "screenshots", s);
+	if (s->thread == NULL) {
+		goto fail;
+	}
+	return s;
+
+fail:
+	SDL_DestroyCondition(s->changed);
+	SDL_DestroyMutex(s->mutex);
+	free(s);
+	return NULL;
+}
+
+// Finishes the screenshots that are queued.
+void
+screenshots_destroy(Screenshots *s)
+{
+	SDL_LockMutex(s->mutex);
+	s->quit = true;
+	SDL_SignalCondition(s->changed);
+	SDL_UnlockMutex(s->mutex);
+	SDL_WaitThread(s->thread, NULL);
+	SDL_DestroyCondition(s->changed);
+	SDL_DestroyMutex(s->mutex);
+	free(s);
+}
+
+// Queues RGBA pixels, bottom row first as read from OpenGL, to be written
+// to a PNG file. Returns false if too many screenshots are already queued.
+bool
+screenshots_save(Screenshots *s, char const *path, uint8_t const *rgba,
+    int width, int height)
+{
+	Shot *shot = calloc(1, sizeof(Shot));
+	size_t size = (size_t)width * height * 4;
+	uint8_t *copy = shot != NULL ? malloc(size) : NULL;
+	if (copy == NULL) {
+		free(shot);
+		return false;
+	}
+	memcpy(copy, rgba, size);
+	snprintf(shot->path, sizeof(shot->path), "%s", path);
+	shot->rgba = copy;
+	shot->width = width;
+	shot->height = height;
+	return enqueue(s, shot);
+}
+
+// Queues a view to be rendered off-screen with a backend and written to a
+// PNG file. The canvas only gives the view, iteration cap and size.
+bool
+screenshots_render(Screenshots *s, char const *path, char const *backend,
+    Canvas const *canvas, RenderMode mode)
+{
+	Shot *shot = calloc(1, sizeof(Shot));
+	if (shot == NULL) {
+		return false;
+	}
+	snprintf(shot->path, sizeof(shot->path), "%s", path);
+	shot->width = canvas->width;
+	shot->height = canvas->height;
+	shot->backend = backend;
+	shot->canvas = *canvas;
+	shot->canvas.counts = NULL;
+	shot->mode = mode;
+	return enqueue(s, shot);
+}
+
+// Queues a view to be sampled into an iteration file. The canvas only gives
+// the view, iteration cap and size.
+bool
+screenshots_iterations(Screenshots *s, char const *path,
+    Canvas const *canvas)
+{
+	Shot *shot = calloc(1, sizeof(Shot));
+	if (shot == NULL) {
+		return false;
+	}
+	snprintf(shot->path, sizeof(shot->path), "%s", path);
+	shot->width = canvas->width;
+	shot->height = canvas->height;
+	shot->canvas = *canvas;
+	shot->canvas.counts = NULL;
+	shot->iterations = true;
+	return enqueue(s, shot);
+}
+
+static bool
+enqueue(Screenshots *s, Shot *shot)
+{
+	SDL_LockMutex(s->mutex);
+	bool ok = s->pending < SCREENSHOT_QUEUE;
+	if (ok) {
+		if (s->tail != NULL) {
+			s->tail->next = shot;
+		} else {
+			s->head = shot;
+		}
+		s->tail = shot;
+		++s->pending;
+		SDL_SignalCondition(s->changed);
+	}
+	SDL_UnlockMutex(s->mutex);
+	if (!ok) {
+		free(shot->rgba);
+		free(shot);
+	}
+	return ok;
+}
+
+static int
+run_saver(void *data)
+{
+	Screenshots *s = data;
+	SDL_LockMutex(s->mutex);
+	for (;;) {
+		while (s->head == NULL && !s->quit) {
+			SDL_WaitCondition(s->changed, s->mutex);
+		}
+		Shot *shot = s->head;
+		if (shot == NULL) {
+			break;
+		}
+		SDL_UnlockMutex(s->mutex);
+
+		if (save(shot)) {
+			fprintf(stderr, "saved %s\n", shot->path);
+		} else if (shot->iterations) {
+			fprintf(stderr, "%s: cannot write iteration file\n",
+			    shot->path);
+		} else {
+			fprintf(stderr, "%s: cannot save screenshot\n",
+			    shot->path);
+		}
+
+		SDL_LockMutex(s->mutex);
+		s->head = shot->next;
+		if (s->head == NULL) {
+			s->tail = NULL;
+		}
+		--s->pending;
+		free(shot->rgba);
+		free(shot);
+	}
+	SDL_UnlockMutex(s->mutex);
+	return 0;
+}
+
+static bool
+save(Shot *shot)
+{
+	int w = shot->width, h = shot->height;
+	if (shot->iterations) {
+		return iterfile_render(shot->path, &shot->canvas.view,
+		    shot->canvas.iterations, w, h);
+	}
+	size_t stride = (size_t)w * 4;
+	bool top_down = shot->rgba == NULL;
+	if (top_down) {
+		Backend *b = backend_create(shot->backend);
+		Canvas *c = &shot->canvas;
+		shot->rgba = malloc(stride * h);
+		bool ok = b != NULL && shot->rgba != NULL &&
+		    canvas_init(c, &c->view, c->iterations, w, h) &&
+		    backend_render(b, c, shot->mode);
+		if (ok) {
+			Rect all = {0, 0, w, h};
+			colorize(c, &all, shot->rgba);
+		}
+		canvas_free(c);
+		if (b != NULL) {
+			backend_destroy(b);
+		}
+		if (!ok) {
+			return false;
+		}
+	}
+
+	ImageWriter *writer = image_create(shot->path, w, h);
+	bool ok = writer != NULL;
+	for (int y = 0; ok && y < h; ++y) {
+		int row = top_down ? y : h - 1 - y;
+		ok = image_write(writer, shot->rgba + row * stride, 1);
+	}
+	if (writer != NULL) {
+		ok &= image_close(writer);
+	}
+	return ok;
+}
@@ -0,0 +1,33 @@
+// Copyright (c) 2025 Charles Hood <chood@chood.net>
+//
+// This program is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef SCREENSHOT_H
+#define SCREENSHOT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "render.h"
+
+typedef struct Screenshots Screenshots;
+
+Screenshots *screenshots_create(void);
+void screenshots_destroy(Screenshots *);
+bool screenshots_save(Screenshots *, char const *, uint8_t const *, int,
+    int);
+bool screenshots_render(Screenshots *, char const *, char const *,
+    Canvas const *, RenderMode);
+bool screenshots_iterations(Screenshots *, char const *, Canvas const *);
+
+#endif
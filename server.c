@@ -0,0 +1,410 @@
+// Copyright (c) 2025 Charles Hood <chood@chood.net>
+//
+// This program is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <SDL3/SDL.h>
+#include "cache.h"
+#include "headless.h"
+#include "image.h"
+#include "net.h"
+#include "pool.h"
+#include "server.h"
+
+#define SERVER_TILE_SIZE 256
+#define SERVER_MAX_LEVEL 30
+#define SERVER_CONNECTIONS 256
+#define SERVER_TIMEOUT 30
+#define SERVER_REQUEST_BYTES 8192
+
+typedef struct Server Server;
+
+// A tile that is being rendered, which every request for it waits for.
+typedef struct Render Render;
+struct Render {
+	Server *server;
+	TileKey key;
+	bool done;
+	uint8_t *png;
+	size_t length;
+	int waiters;
+	Render *next;
+};
+
+struct Server {
+	View region;
+	int iterations;
+	RenderMode mode;
+	Pool *pool;
+	Cache *cache;
+	SDL_Mutex *mutex;
+	SDL_Condition *changed;
+	Render *renders;
+	int connections;
+};
+
+// Renders share a condition with the accept loop, which waits for a free
+// connection slot, so every change is broadcast.
+
+typedef struct {
+	Server *server;
+	int fd;
+} Connection;
+
+static int run_connection(void *);
+static bool handle_request(Server *, int, char *, bool *);
+static bool send_response(int, char const *, char const *,
+    uint8_t const *, size_t, bool);
+static bool get_tile(Server *, TileKey const *, uint8_t **, size_t *);
+static bool find_cached(Server *, TileKey const *, uint8_t **, size_t *);
+static void render_job(void *);
+static void usage(void);
+
+// Serves PNG tiles of a square region at /z/x/y.png, laid out like the tiles
+// of pyramid. Tiles are rendered on the thread pool when first requested,
+// and concurrent requests for a tile that is being rendered wait for that
+// render instead of starting their own. Each connection has a thread of its
+// own and may send any number of requests.
+int
+serve_main(int argc, char **argv)
+{
+	RenderOptions o;
+	render_options_init(&o);
+	char const *address = "127.0.0.1:8080";
+	size_t cache_size = 256;
+	int c;
+	while ((c = getopt(argc, argv, "c:i:l:M:m:s:")) != -1) {
+		if (c == 'l') {
+			address = optarg;
+		} else if (c == 'M') {
+			cache_size = strtoul(optarg, NULL, 10);
+		} else if (!render_options_parse(&o, c, optarg)) {
+			usage();
+		}
+	}
+	if (optind != argc) {
+		usage();
+	}
+
+	Server s;
+	memset(&s, 0, sizeof(Server));
+	s.region = o.focus;
+	s.iterations = o.iterations;
+	s.mode = o.mode;
+	s.pool = pool_create(0);
+	s.cache = cache_create(cache_size << 20);
+	s.mutex = SDL_CreateMutex();
+	s.changed = SDL_CreateCondition();
+	if (s.pool == NULL || s.cache == NULL || s.mutex == NULL ||
+	    s.changed == NULL) {
+		exit(EXIT_FAILURE);
+	}
+	int listen_fd = net_listen(address);
+	if (listen_fd == -1) {
+		fprintf(stderr, "%s: cannot listen\n", address);
+		return EXIT_FAILURE;
+	}
+	fprintf(stderr, "serving tiles at %s/z/x/y.png\n", address);
+
+	for (;;) {
+		SDL_LockMutex(s.mutex);
+		while (s.connections >= SERVER_CONNECTIONS) {
+			SDL_WaitCondition(s.changed, s.mutex);
+		}
+		SDL_UnlockMutex(s.mutex);
+
+		int fd = accept(listen_fd, NULL, NULL);
+		if (fd == -1) {
+			continue;
+		}
+		// Idle connections are closed after a while so that they do
+		// not hold on to their threads.
+		struct timeval timeout = {SERVER_TIMEOUT, 0};
+		setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout,
+		    sizeof(timeout));
+
+		Connection *connection = malloc(sizeof(Connection));
+		SDL_Thread *thread = NULL;
+		if (connection != NULL) {
+			connection->server = &s;
+			connection->fd = fd;
+			SDL_LockMutex(s.mutex);
+			++s.connections;
+			SDL_UnlockMutex(s.mutex);
+			thread = SDL_CreateThread(run_connection,
+			    "connection", connection);
+		}
+		if (thread == NULL) {
+			close(fd);
+			free(connection);
+			SDL_LockMutex(s.mutex);
+			--s.connections;
+			SDL_UnlockMutex(s.mutex);
+			continue;
+		}
+		SDL_DetachThread(thread);
+	}
+}
+
+// Reads requests until the client closes the connection, asks for it to be
+// closed, or sends something that is not understood.
+static int
+run_connection(void *data)
+{
+	Connection *connection = data;
+	Server *s = connection->server;
+	int fd = connection->fd;
+	free(connection);
+
+	char buffer[SERVER_REQUEST_BYTES + 1];
+	size_t used = 0;
+	bool keep_alive = true;
+	while (keep_alive) {
+		buffer[used] = '\0';
+		char *end = strstr(buffer, "\r\n\r\n");
+		if (end == NULL) {
+			if (used == SERVER_REQUEST_BYTES) {
+				break;
+			}
+			ssize_t r = recv(fd, buffer + used,
+			    SERVER_REQUEST_BYTES - used, 0);
+			if (r <= 0) {
+				break;
+			}
+			used += r;
+			continue;
+		}
+
+		*end = '\0';
+		if (!handle_request(s, fd, buffer, &keep_alive)) {
+			break;
+		}
+		size_t length = end + 4 - buffer;
+		memmove(buffer, end + 4, used - length);
+		used -= length;
+	}
+	close(fd);
+
+	SDL_LockMutex(s->mutex);
+	--s->connections;
+	SDL_BroadcastCondition(s->changed);
+	SDL_UnlockMutex(s->mutex);
+	return 0;
+}
+
+// Answers the request whose header is given. Returns false if the response
+// could not be sent.
+static bool
+handle_request(Server *s, int fd, char *header, bool *keep_alive)
+{
+	char method[8], target[128], version[16];
+	if (sscanf(header, "%7s %127s %15s", method, target, version) != 3) {
+		*keep_alive = false;
+		return send_response(fd, "400 Bad Request", NULL, NULL, 0,
+		    false);
+	}
+	// HTTP/1.1 connections stay open unless the client says otherwise,
+	// and older ones are always closed.
+	*keep_alive = strcmp(version, "HTTP/1.1") == 0;
+	for (char *line = strstr(header, "\r\n"); line != NULL;
+	    line = strstr(line + 2, "\r\n")) {
+		if (strncasecmp(line + 2, "connection:", 11) == 0) {
+			char const *value = line + 13;
+			value += strspn(value, " \t");
+			*keep_alive &= strncasecmp(value, "close", 5) != 0;
+		}
+	}
+
+	bool head = strcmp(method, "HEAD") == 0;
+	if (!head && strcmp(method, "GET") != 0) {
+		return send_response(fd, "405 Method Not Allowed", NULL,
+		    NULL, 0, *keep_alive);
+	}
+
+	TileKey key = {0, 0, 0, s->iterations, s->mode};
+	int n = 0;
+	if (sscanf(target, "/%d/%" SCNd64 "/%" SCNd64 ".png%n", &key.level,
+	    &key.x, &key.y, &n) != 3 || target[n] != '\0' || key.level < 0 ||
+	    key.level > SERVER_MAX_LEVEL || key.x < 0 || key.y < 0 ||
+	    key.x >= (int64_t)1 << key.level ||
+	    key.y >= (int64_t)1 << key.level) {
+		return send_response(fd, "404 Not Found", NULL, NULL, 0,
+		    *keep_alive);
+	}
+
+	uint8_t *png;
+	size_t length;
+	if (!get_tile(s, &key, &png, &length)) {
+		return send_response(fd, "500 Internal Server Error", NULL,
+		    NULL, 0, *keep_alive);
+	}
+	bool ok = send_response(fd, "200 OK", "image/png", head ? NULL : png,
+	    length, *keep_alive);
+	free(png);
+	return ok;
+}
+
+// Sends a response with a body of the given type, or with no body if the
+// type is NULL. The length is sent even if the body is left out, as a
+// response to HEAD.
+static bool
+send_response(int fd, char const *status, char const *type,
+    uint8_t const *body, size_t length, bool keep_alive)
+{
+	char header[512];
+	int n = snprintf(header, sizeof(header), "HTTP/1.1 %s\r\n"
+	    "Content-Length: %zu\r\n"
+	    "%s%s%s"
+	    "Cache-Control: public, max-age=86400\r\n"
+	    "Access-Control-Allow-Origin: *\r\n"
+	    "Connection: %s\r\n"
+	    "\r\n", status, type != NULL ? length : 0,
+	    type != NULL ? "Content-Type: " : "", type != NULL ? type : "",
+	    type != NULL ? "\r\n" : "", keep_alive ? "keep-alive" : "close");
+	return net_write(fd, header, n) &&
+	    (body == NULL || net_write(fd, body, length));
+}
+
+// Returns a copy of a tile's PNG image, rendering it if it is not cached and
+// nobody else is rendering it already.
+static bool
+get_tile(Server *s, TileKey const *key, uint8_t **png, size_t *length)
+{
+	if (find_cached(s, key, png, length)) {
+		return true;
+	}
+
+	SDL_LockMutex(s->mutex);
+	Render *r = s->renders;
+	while (r != NULL && (r->key.level != key->level ||
+	    r->key.x != key->x || r->key.y != key->y)) {
+		r = r->next;
+	}
+	// A render inserts its tile into the cache before it is removed from
+	// the list, so a tile that has neither has not been rendered.
+	if (r == NULL && find_cached(s, key, png, length)) {
+		SDL_UnlockMutex(s->mutex);
+		return true;
+	}
+	if (r == NULL) {
+		r = calloc(1, sizeof(Render));
+		if (r == NULL) {
+			SDL_UnlockMutex(s->mutex);
+			return false;
+		}
+		r->server = s;
+		r->key = *key;
+		r->next = s->renders;
+		s->renders = r;
+		pool_submit(s->pool, render_job, r);
+	}
+	++r->waiters;
+	while (!r->done) {
+		SDL_WaitCondition(s->changed, s->mutex);
+	}
+	*png = r->png != NULL ? malloc(r->length) : NULL;
+	if (*png != NULL) {
+		memcpy(*png, r->png, r->length);
+		*length = r->length;
+	}
+	if (--r->waiters == 0) {
+		Render **p = &s->renders;
+		while (*p != r) {
+			p = &(*p)->next;
+		}
+		*p = r->next;
+		free(r->png);
+		free(r);
+	}
+	SDL_UnlockMutex(s->mutex);
+	return *png != NULL;
+}
+
+static bool
+find_cached(Server *s, TileKey const *key, uint8_t **png, size_t *length)
+{
+	cache_lock(s->cache);
+	uint8_t const *data = cache_find(s->cache, key, length);
+	*png = data != NULL ? malloc(*length) : NULL;
+	if (*png != NULL) {
+		memcpy(*png, data, *length);
+	}
+	cache_unlock(s->cache);
+	return *png != NULL;
+}
+
+static void
+render_job(void *data)
+{
+	Render *r = data;
+	Server *s = r->server;
+
+	double half = ldexp(s->region.height, -r->key.level);
+	View v = {
+		s->region.x - s->region.height + (2 * r->key.x + 1) * half,
+		s->region.y + s->region.height - (2 * r->key.y + 1) * half,
+		half,
+		half,
+	};
+	Canvas c;
+	uint8_t *rgba = malloc(SERVER_TILE_SIZE * SERVER_TILE_SIZE * 4);
+	uint8_t *png = NULL;
+	size_t length = 0;
+	if (rgba != NULL && canvas_init(&c, &v, s->iterations,
+	    SERVER_TILE_SIZE, SERVER_TILE_SIZE)) {
+		Rect all = {0, 0, SERVER_TILE_SIZE, SERVER_TILE_SIZE};
+		render(&c, &all, s->mode, NULL);
+		colorize(&c, &all, rgba);
+		canvas_free(&c);
+		if (!image_encode_png(rgba, SERVER_TILE_SIZE,
+		    SERVER_TILE_SIZE, &png, &length)) {
+			png = NULL;
+		}
+	}
+	free(rgba);
+
+	uint8_t *copy = png != NULL ? malloc(length) : NULL;
+	if (copy != NULL) {
+		memcpy(copy, png, length);
+		cache_lock(s->cache);
+		cache_insert(s->cache, &r->key, copy, length);
+		cache_unlock(s->cache);
+	}
+
+	SDL_LockMutex(s->mutex);
+	r->png = png;
+	r->length = length;
+	r->done = true;
+	SDL_BroadcastCondition(s->changed);
+	SDL_UnlockMutex(s->mutex);
+}
+
+static void
+usage(void)
+{
+	fprintf(stderr, "usage: mandelbrot serve [-c x,y] [-s scale] "
+	    "[-i iterations] [-m brute|trace|guess]\n"
+	    "                        [-M cache-megabytes] [-l address]\n");
+	exit(EXIT_FAILURE);
+}
@@ -0,0 +1,95 @@
+// Copyright (c) 2025 Charles Hood <chood@chood.net>
+//
+// This program is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+
+#include <stddef.h>
+#include "shader.h"
+
+// Draws a quad over the whole viewport with frag_position going from the
+// bottom left to the top right corner of the rectangle that transformation
+// describes, as a center and half extents.
+char const vert_shader_source[] = "\
+#version 300 es\n\
+\n\
+uniform vec4 transformation;\n\
+\n\
+out vec2 frag_position;\n\
+\n\
+const vec2 vertices[] = vec2[](\n\
+	vec2(-1., -1.),\n\
+	vec2( 1., -1.),\n\
+	vec2(-1.,  1.),\n\
+	vec2( 1.,  1.)\n\
+);\n\
+\n\
+const int indices[] = int[](0, 1, 2, 3, 2, 1);\n\
+\n\
+void\n\
+main()\n\
+{\n\
+	vec2 p = vertices[indices[gl_VertexID]];\n\
+	gl_Position = vec4(p, 0., 1.);\n\
+	frag_position = transformation.zw * p + transformation.xy;\n\
+}\n\
+";
+
+GLuint
+create_program(char const *vert_source, char const *frag_source)
+{
+	GLuint vert = create_shader(GL_VERTEX_SHADER, vert_source);
+	GLuint frag = create_shader(GL_FRAGMENT_SHADER, frag_source);
+	GLuint program = glCreateProgram();
+	if (vert == 0 || frag == 0 || program == 0) {
+		glDeleteShader(vert);
+		glDeleteShader(frag);
+		glDeleteProgram(program);
+		return 0;
+	}
+
+	glAttachShader(program, vert);
+	glAttachShader(program, frag);
+	glLinkProgram(program);
+
+	glDeleteShader(vert);
+	glDeleteShader(frag);
+
+	GLint status = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &status);
+	if (!status) {
+		glDeleteProgram(program);
+		return 0;
+	}
+
+	return program;
+}
+
+GLuint
+create_shader(GLenum type, char const *source)
+{
+	GLuint shader = glCreateShader(type);
+	if (shader == 0) {
+		return 0;
+	}
+
+	glShaderSource(shader, 1, &source, NULL);
+	glCompileShader(shader);
+	GLint status = GL_FALSE;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+	if (!status) {
+		glDeleteShader(shader);
+		return 0;
+	}
+
+	return shader;
+}
@@ -0,0 +1,502 @@
+// Copyright (c) 2025 Charles Hood <chood@chood.net>
+//
+// This program is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <SDL3/SDL.h>
+#include "codec.h"
+#include "store.h"
+
+#define STORE_MAGIC "MBTILES1"
+#define MIN_SLOTS 1024
+#define GROWTH (16 << 20)
+
+enum {
+	SLOT_EMPTY,
+	SLOT_LIVE,
+	SLOT_DELETED,
+};
+
+// The file is a header, an open addressing hash table of slots and the tile
+// data, all in host byte order.
+typedef struct {
+	char magic[8];
+	uint64_t slot_count;
+	uint64_t live_count;
+	uint64_t deleted_count;
+	uint64_t data_offset;
+	uint64_t data_end;
+	uint64_t live_bytes;
+	uint64_t clock;
+} Header;
+
+typedef struct {
+	int64_t x;
+	int64_t y;
+	int32_t level;
+	int32_t iterations;
+	uint32_t mode;
+	uint32_t formula;
+	uint64_t offset;
+	uint32_t length;
+	uint32_t state;
+	uint64_t used;
+} Slot;
+
+struct Store {
+	SDL_Mutex *mutex;
+	char *path;
+	int fd;
+	size_t cap;
+	uint8_t *map;
+	size_t map_size;
+};
+
+static bool map_file(Store *);
+static bool create_file(int, uint64_t);
+static bool valid_header(Store *);
+static Header *header(Store *);
+static Slot *slots(Store *);
+static Slot *find_slot(Store *, TileKey const *, bool);
+static uint64_t hash(TileKey const *);
+static bool slot_matches(Slot const *, TileKey const *);
+static bool reserve(Store *, uint64_t);
+static void evict(Store *, uint64_t);
+static int cmp_used(void const *, void const *);
+static bool rewrite(Store *, uint64_t);
+
+// Opens or creates a store that is kept below the given size in bytes. The
+// file is locked so that only one process uses it at a time.
+Store *
+store_open(char const *path, size_t cap)
+{
+	Store *s = calloc(1, sizeof(Store));
+	if (s == NULL) {
+		return NULL;
+	}
+	s->fd = -1;
+	s->cap = cap;
+	s->path = malloc(strlen(path) + 1);
+	s->mutex = SDL_CreateMutex();
+	if (s->path == NULL || s->mutex == NULL) {
+		store_close(s);
+		return NULL;
+	}
+	strcpy(s->path, path);
+
+	s->fd = open(path, O_RDWR | O_CREAT, 0644);
+	struct flock lock;
+	memset(&lock, 0, sizeof(lock));
+	lock.l_type = F_WRLCK;
+	lock.l_whence = SEEK_SET;
+	if (s->fd == -1 || fcntl(s->fd, F_SETLK, &lock) == -1) {
+		store_close(s);
+		return NULL;
+	}
+
+	struct stat st;
+	if (fstat(s->fd, &st) == -1 || (st.st_size == 0 &&
+	    !create_file(s->fd, MIN_SLOTS)) || !map_file(s)) {
+		store_close(s);
+		return NULL;
+	}
+	if (!valid_header(s)) {
+		store_close(s);
+		return NULL;
+	}
+	return s;
+}
+
+void
+store_close(Store *s)
+{
+	if (s->map != NULL) {
+		munmap(s->map, s->map_size);
+	}
+	if (s->fd != -1) {
+		close(s->fd);
+	}
+	SDL_DestroyMutex(s->mutex);
+	free(s->path);
+	free(s);
+}
+
+// Decodes a stored tile into TILE_SIZE * TILE_SIZE counts. Tiles are kept as
+// encoded by codec_encode(), which leaves tiles written before there was an
+// encoding readable as they are.
+bool
+store_load(Store *s, TileKey const *key, uint32_t *counts)
+{
+	SDL_LockMutex(s->mutex);
+	Slot *slot = find_slot(s, key, false);
+	bool found = slot != NULL && slot->state == SLOT_LIVE &&
+	    slot->offset >= header(s)->data_offset &&
+	    slot->offset <= header(s)->data_end &&
+	    slot->length <= header(s)->data_end - slot->offset &&
+	    codec_decode(s->map + slot->offset, slot->length, TILE_SIZE,
+	    TILE_SIZE, counts);
+	if (found) {
+		slot->used = ++header(s)->clock;
+	}
+	SDL_UnlockMutex(s->mutex);
+	return found;
+}
+
+// Saves a tile encoded by codec_encode().
+void
+store_save(Store *s, TileKey const *key, uint8_t const *data,
+    uint32_t length)
+{
+	SDL_LockMutex(s->mutex);
+	Slot *slot = find_slot(s, key, false);
+	if ((slot == NULL || slot->state != SLOT_LIVE) &&
+	    reserve(s, length)) {
+		Header *h = header(s);
+		slot = find_slot(s, key, true);
+		if (slot->state == SLOT_DELETED) {
+			--h->deleted_count;
+		}
+		slot->x = key->x;
+		slot->y = key->y;
+		slot->level = key->level;
+		slot->iterations = key->iterations;
+		slot->mode = key->mode;
+		slot->formula = RENDER_FORMULA;
+		slot->offset = h->data_end;
+		slot->length = length;
+		slot->used = ++h->clock;
+		memcpy(s->map + h->data_end, data, length);
+		slot->state = SLOT_LIVE;
+
+		h->data_end += length;
+		h->live_bytes += length;
+		++h->live_count;
+	}
+	SDL_UnlockMutex(s->mutex);
+}
+
+// Rewrites the store without the space left behind by evicted tiles.
+bool
+store_compact(Store *s)
+{
+	SDL_LockMutex(s->mutex);
+	bool ok = rewrite(s, header(s)->live_count);
+	SDL_UnlockMutex(s->mutex);
+	return ok;
+}
+
+void
+store_stats(Store *s, StoreStats *stats)
+{
+	SDL_LockMutex(s->mutex);
+	stats->tiles = header(s)->live_count;
+	stats->live_bytes = header(s)->live_bytes;
+	stats->file_size = s->map_size;
+	SDL_UnlockMutex(s->mutex);
+}
+
+int
+compact_main(int argc, char **argv)
+{
+	if (argc != 2) {
+		fprintf(stderr, "usage: mandelbrot compact store\n");
+		return EXIT_FAILURE;
+	}
+
+	Store *s = store_open(argv[1], SIZE_MAX);
+	if (s == NULL) {
+		fprintf(stderr, "%s: cannot open store, or it is in use\n",
+		    argv[1]);
+		return EXIT_FAILURE;
+	}
+
+	StoreStats before, after;
+	store_stats(s, &before);
+	bool ok = store_compact(s);
+	store_stats(s, &after);
+	store_close(s);
+	if (!ok) {
+		fprintf(stderr, "%s: compaction failed\n", argv[1]);
+		return EXIT_FAILURE;
+	}
+
+	printf("%llu tiles, %llu bytes of tile data, file size %llu -> %llu\n",
+	    (unsigned long long)after.tiles,
+	    (unsigned long long)after.live_bytes,
+	    (unsigned long long)before.file_size,
+	    (unsigned long long)after.file_size);
+	return EXIT_SUCCESS;
+}
+
+static bool
+map_file(Store *s)
+{
+	if (s->map != NULL) {
+		munmap(s->map, s->map_size);
+		s->map = NULL;
+	}
+
+	struct stat st;
+	if (fstat(s->fd, &st) == -1) {
+		return false;
+	}
+	void *map = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+	    s->fd, 0);
+	if (map == MAP_FAILED) {
+		return false;
+	}
+	s->map = map;
+	s->map_size = st.st_size;
+	return true;
+}
+
+static bool
+create_file(int fd, uint64_t slot_count)
+{
+	Header h;
+	memset(&h, 0, sizeof(Header));
+	memcpy(h.magic, STORE_MAGIC, 8);
+	h.slot_count = slot_count;
+	h.data_offset = sizeof(Header) + slot_count * sizeof(Slot);
+	h.data_end = h.data_offset;
+
+	return ftruncate(fd, 0) == 0 && ftruncate(fd, h.data_offset) == 0 &&
+	    pwrite(fd, &h, sizeof(Header), 0) == sizeof(Header);
+}
+
+// Checks that the slot table and the data that the header describes fit in
+// the file, so that a damaged or foreign file cannot make lookups read past
+// the mapping.
+static bool
+valid_header(Store *s)
+{
+	if (s->map_size < sizeof(Header) ||
+	    memcmp(header(s)->magic, STORE_MAGIC, 8) != 0) {
+		return false;
+	}
+	Header const *h = header(s);
+	uint64_t n = h->slot_count;
+	return n != 0 && (n & (n - 1)) == 0 &&
+	    n <= (s->map_size - sizeof(Header)) / sizeof(Slot) &&
+	    h->data_offset == sizeof(Header) + n * sizeof(Slot) &&
+	    h->data_offset <= h->data_end && h->data_end <= s->map_size;
+}
+
+static Header *
+header(Store *s)
+{
+	return (Header *)s->map;
+}
+
+static Slot *
+slots(Store *s)
+{
+	return (Slot *)(s->map + sizeof(Header));
+}
+
+// Returns the slot of a key, or if it is not stored, NULL or the slot where
+// it would be inserted.
+static Slot *
+find_slot(Store *s, TileKey const *key, bool insert)
+{
+	uint64_t mask = header(s)->slot_count - 1;
+	Slot *deleted = NULL;
+	for (uint64_t i = hash(key) & mask;; i = (i + 1) & mask) {
+		Slot *slot = &slots(s)[i];
+		if (slot->state == SLOT_EMPTY) {
+			if (!insert) {
+				return NULL;
+			}
+			return deleted != NULL ? deleted : slot;
+		}
+		if (slot->state == SLOT_DELETED) {
+			if (deleted == NULL) {
+				deleted = slot;
+			}
+		} else if (slot_matches(slot, key)) {
+			return slot;
+		}
+	}
+}
+
+static uint64_t
+hash(TileKey const *k)
+{
+	uint64_t h = 0xcbf29ce484222325u;
+	uint64_t fields[] = {k->level, k->x, k->y, k->iterations, k->mode,
+	    RENDER_FORMULA};
+	for (size_t i = 0; i < SDL_arraysize(fields); ++i) {
+		h = (h ^ fields[i]) * 0x100000001b3u;
+		h ^= h >> 29;
+	}
+	return h;
+}
+
+static bool
+slot_matches(Slot const *slot, TileKey const *key)
+{
+	return slot->x == key->x && slot->y == key->y &&
+	    slot->level == key->level && slot->iterations == key->iterations &&
+	    slot->mode == (uint32_t)key->mode &&
+	    slot->formula == RENDER_FORMULA;
+}
+
+// Makes room for one more tile of the given length, evicting the least
+// recently used tiles when the store would grow past its cap, and rewriting
+// the file when the hash table fills up or evicted tiles leave too much
+// unused space.
+static bool
+reserve(Store *s, uint64_t length)
+{
+	Header *h = header(s);
+	if (length > s->cap / 2) {
+		return false;
+	}
+	if (h->live_bytes + length > s->cap) {
+		evict(s, s->cap - s->cap / 4);
+	}
+
+	h = header(s);
+	if (2 * (h->live_count + h->deleted_count + 1) > h->slot_count ||
+	    h->data_end + length > s->cap) {
+		if (!rewrite(s, h->live_count + 1)) {
+			return false;
+		}
+		h = header(s);
+	}
+
+	if (h->data_end + length > s->map_size) {
+		uint64_t size = h->data_end + length + GROWTH;
+		if (size > s->cap) {
+			size = h->data_end + length > s->cap ?
+			    h->data_end + length : s->cap;
+		}
+		if (ftruncate(s->fd, size) == -1 || !map_file(s)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// Drops the least recently used tiles until at most target bytes are left.
+static void
+evict(Store *s, uint64_t target)
+{
+	Header *h = header(s);
+	Slot **live = malloc(h->live_count * sizeof(Slot *));
+	if (live == NULL) {
+		return;
+	}
+	size_t n = 0;
+	for (uint64_t i = 0; i < h->slot_count; ++i) {
+		if (slots(s)[i].state == SLOT_LIVE) {
+			live[n++] = &slots(s)[i];
+		}
+	}
+	qsort(live, n, sizeof(Slot *), cmp_used);
+
+	for (size_t i = 0; i < n && h->live_bytes > target; ++i) {
+		live[i]->state = SLOT_DELETED;
+		h->live_bytes -= live[i]->length;
+		--h->live_count;
+		++h->deleted_count;
+	}
+	free(live);
+}
+
+static int
+cmp_used(void const *a, void const *b)
+{
+	uint64_t x = (*(Slot *const *)a)->used, y = (*(Slot *const *)b)->used;
+	return (x > y) - (x < y);
+}
+
+// Writes the live tiles into a new file with room for at least the given
+// number of tiles in its hash table, and replaces the store with it.
+static bool
+rewrite(Store *s, uint64_t tiles)
+{
+	uint64_t slot_count = MIN_SLOTS;
+	while (slot_count < 4 * tiles) {
+		slot_count *= 2;
+	}
+
+	char *path = malloc(strlen(s->path) + 5);
+	if (path == NULL) {
+		return false;
+	}
+	sprintf(path, "%s.new", s->path);
+	int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd == -1) {
+		free(path);
+		return false;
+	}
+
+	Header *old = header(s);
+	Header h = *old;
+	h.slot_count = slot_count;
+	h.deleted_count = 0;
+	h.data_offset = sizeof(Header) + slot_count * sizeof(Slot);
+	h.data_end = h.data_offset;
+
+	Slot *table = calloc(slot_count, sizeof(Slot));
+	bool ok = table != NULL && create_file(fd, slot_count);
+	for (uint64_t i = 0; ok && i < old->slot_count; ++i) {
+		Slot slot = slots(s)[i];
+		if (slot.state != SLOT_LIVE) {
+			continue;
+		}
+		ok = pwrite(fd, s->map + slot.offset, slot.length,
+		    h.data_end) == slot.length;
+
+		TileKey key = {slot.level, slot.x, slot.y, slot.iterations,
+		    slot.mode};
+		uint64_t j = hash(&key) & (slot_count - 1);
+		while (table[j].state != SLOT_EMPTY) {
+			j = (j + 1) & (slot_count - 1);
+		}
+		slot.offset = h.data_end;
+		table[j] = slot;
+		h.data_end += slot.length;
+	}
+	ok = ok && pwrite(fd, &h, sizeof(Header), 0) == sizeof(Header) &&
+	    pwrite(fd, table, slot_count * sizeof(Slot), sizeof(Header)) ==
+	    (ssize_t)(slot_count * sizeof(Slot)) && fsync(fd) == 0;
+	free(table);
+
+	struct flock lock;
+	memset(&lock, 0, sizeof(lock));
+	lock.l_type = F_WRLCK;
+	lock.l_whence = SEEK_SET;
+	if (!ok || fcntl(fd, F_SETLK, &lock) == -1 ||
+	    rename(path, s->path) == -1) {
+		close(fd);
+		unlink(path);
+		free(path);
+		return false;
+	}
+	free(path);
+
+	close(s->fd);
+	s->fd = fd;
+	return map_file(s);
+}
@@ -0,0 +1,40 @@
+// Copyright (c) 2025 Charles Hood <chood@chood.net>
+//
+// This program is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef STORE_H
+#define STORE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "cache.h"
+
+typedef struct {
+	uint64_t tiles;
+	uint64_t live_bytes;
+	uint64_t file_size;
+} StoreStats;
+
+typedef struct Store Store;
+
+Store *store_open(char const *, size_t);
+void store_close(Store *);
+bool store_load(Store *, TileKey const *, uint32_t *);
+void store_save(Store *, TileKey const *, uint8_t const *, uint32_t);
+bool store_compact(Store *);
+void store_stats(Store *, StoreStats *);
+int compact_main(int, char **);
+
+#endif
@@ -0,0 +1,195 @@
+// Copyright (c) 2025 Charles Hood <chood@chood.net>
+//
+// This program is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <SDL3/SDL.h>
+#include "trace.h"
+
+// Spans past this many are dropped, so that a long session takes at most
+// 128 MiB.
+#define TRACE_MAX_EVENTS (1 << 22)
+#define TRACE_MAX_THREADS 256
+
+typedef struct {
+	char const *name;
+	SDL_ThreadID thread;
+	Uint64 start;
+	Uint64 duration;
+} Event;
+
+typedef struct {
+	SDL_ThreadID id;
+	char const *name;
+} Thread;
+
+// Records spans from any thread and writes them as JSON in the Chrome trace
+// event format, which Perfetto and chrome://tracing can open. Tracing is off
+// unless trace_open() was called, and otherwise every span costs a lock.
+typedef struct {
+	char const *path;
+	SDL_Mutex *mutex;
+	Uint64 origin;
+	Event *events;
+	size_t count;
+	size_t capacity;
+	Thread threads[TRACE_MAX_THREADS];
+	int thread_count;
+	bool closed;
+} Trace;
+
+static Trace *trace;
+
+static int thread_index(SDL_ThreadID);
+
+// Starts recording spans, to be written to a file once trace_close() is
+// called. Must be called before any thread that records spans is started.
+bool
+trace_open(char const *path)
+{
+	Trace *t = calloc(1, sizeof(Trace));
+	if (t == NULL) {
+		return false;
+	}
+	t->path = path;
+	t->mutex = SDL_CreateMutex();
+	if (t->mutex == NULL) {
+		free(t);
+		return false;
+	}
+	t->origin = SDL_GetTicksNS();
+	trace = t;
+	return true;
+}
+
+// Writes the spans recorded so far. Spans that end afterwards are dropped,
+// so threads that are still running may keep calling trace_end().
+bool
+trace_close(void)
+{
+	Trace *t = trace;
+	if (t == NULL) {
+		return true;
+	}
+	SDL_LockMutex(t->mutex);
+	t->closed = true;
+	FILE *f = fopen(t->path, "w");
+	if (f == NULL) {
+		SDL_UnlockMutex(t->mutex);
+		return false;
+	}
+
+	fprintf(f, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+	for (int i = 0; i < t->thread_count; ++i) {
+		fprintf(f, "{\"name\": \"thread_name\", \"ph\": \"M\", "
+		    "\"pid\": 1, \"tid\": %d, \"args\": {\"name\": \"%s\"}},\n",
+		    i + 1, t->threads[i].name);
+	}
+	for (size_t i = 0; i < t->count; ++i) {
+		Event const *e = &t->events[i];
+		fprintf(f, "{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, "
+		    "\"tid\": %d, \"ts\": %.3f, \"dur\": %.3f},\n", e->name,
+		    thread_index(e->thread) + 1, (e->start - t->origin) / 1e3,
+		    e->duration / 1e3);
+	}
+	fprintf(f, "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, "
+	    "\"args\": {\"name\": \"mandelbrot\"}}\n]}\n");
+	bool ok = !ferror(f);
+	ok &= fclose(f) == 0;
+	if (t->count == TRACE_MAX_EVENTS) {
+		fprintf(stderr, "%s: trace is full, later spans were "
+		    "dropped\n", t->path);
+	}
+	SDL_UnlockMutex(t->mutex);
+	return ok;
+}
+
+// Names the calling thread in the trace.
+void
+trace_thread(char const *name)
+{
+	Trace *t = trace;
+	if (t == NULL) {
+		return;
+	}
+	SDL_LockMutex(t->mutex);
+	int i = thread_index(SDL_GetCurrentThreadID());
+	if (i >= 0) {
+		t->threads[i].name = name;
+	}
+	SDL_UnlockMutex(t->mutex);
+}
+
+// Returns the start of a span to pass to trace_end(), which is zero if
+// tracing is off.
+Uint64
+trace_begin(void)
+{
+	return trace != NULL ? SDL_GetTicksNS() : 0;
+}
+
+// Records a span of the calling thread from the given start until now. The
+// name must stay valid until the trace is closed.
+void
+trace_end(char const *name, Uint64 start)
+{
+	Trace *t = trace;
+	if (t == NULL || start == 0) {
+		return;
+	}
+	Uint64 end = SDL_GetTicksNS();
+	SDL_LockMutex(t->mutex);
+	if (t->closed || t->count == TRACE_MAX_EVENTS) {
+		SDL_UnlockMutex(t->mutex);
+		return;
+	}
+	if (t->count == t->capacity) {
+		size_t capacity = t->capacity > 0 ? 2 * t->capacity : 4096;
+		Event *events = realloc(t->events, capacity * sizeof(Event));
+		if (events == NULL) {
+			SDL_UnlockMutex(t->mutex);
+			return;
+		}
+		t->events = events;
+		t->capacity = capacity;
+	}
+	Event *e = &t->events[t->count++];
+	e->name = name;
+	e->thread = SDL_GetCurrentThreadID();
+	e->start = start;
+	e->duration = end - start;
+	thread_index(e->thread);
+	SDL_UnlockMutex(t->mutex);
+}
+
+// Returns the index of a thread, adding it if it is new, or -1 if there are
+// too many threads. The trace must be locked.
+static int
+thread_index(SDL_ThreadID id)
+{
+	Trace *t = trace;
+	for (int i = 0; i < t->thread_count; ++i) {
+		if (t->threads[i].id == id) {
+			return i;
+		}
+	}
+	if (t->thread_count == TRACE_MAX_THREADS) {
+		return -1;
+	}
+	Thread *thread = &t->threads[t->thread_count];
+	thread->id = id;
+	thread->name = "thread";
+	return t->thread_count++;
+}
@@ -0,0 +1,28 @@
+// Copyright (c) 2025 Charles Hood <chood@chood.net>
+//
+// This program is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdbool.h>
+#include <SDL3/SDL.h>
+
+bool trace_open(char const *);
+bool trace_close(void);
+void trace_thread(char const *);
+Uint64 trace_begin(void);
+void trace_end(char const *, Uint64);
+
+#endif